@@ -1,22 +1,56 @@
 #version 330 core
 
-layout(location = 0) in vec3 aPosition;
-layout(location = 1) in vec3 aNormal;
+layout(location = 0) in float aHeight;
+layout(location = 1) in vec2 aOctahedralNormal;
+layout(location = 3) in float aMorphHeight;
 
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 uniform mat4 normalMatrix;
+uniform mat4 iViewMatrix;
 
 uniform float textureTiles;
 
+// chunk vertices are a grid, only their heights are stored; skirt vertices follow it, along the N, E, S then W edge
+uniform float gridSpacing;
+uniform int gridSideVertices;
+
+// heights blend into aMorphHeight, the parent chunk's surface, from morphRange.x to morphRange.y away from the camera
+// (measured on the ground plane, like the quadtree picks levels); an empty range turns it off
+uniform vec2 morphRange;
+
 out vec3 normal;
 out vec2 UVs;
 
+// unfolds factory.c's encodeOctahedralNormal
+vec3 decodeOctahedralNormal(vec2 p)
+{
+	vec3 n = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+	if (n.y < 0.0)
+		n.xz = (1.0 - abs(n.zx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main()
 {
-	vec4 normalVec4 = normalMatrix * vec4(aNormal, 0.0);
-	vec4 worldPos = modelMatrix * vec4(aPosition, 1.0);
+	vec4 normalVec4 = normalMatrix * vec4(decodeOctahedralNormal(aOctahedralNormal), 0.0);
+	vec3 position = vec3(gl_VertexID % gridSideVertices, 0.0, gl_VertexID / gridSideVertices) * gridSpacing;
+	int skirtVertex = gl_VertexID - gridSideVertices * gridSideVertices;
+	if (skirtVertex >= 0){
+		int edge = skirtVertex / gridSideVertices, along = skirtVertex % gridSideVertices, last = gridSideVertices - 1;
+		vec2 gridPosition = edge == 0 ? vec2(along, 0) : edge == 1 ? vec2(last, along) : edge == 2 ? vec2(along, last) : vec2(0, along);
+		position = vec3(gridPosition.x, 0.0, gridPosition.y) * gridSpacing;
+	}
+	vec4 worldPos = modelMatrix * vec4(position, 1.0);
+	float morph = 0.0;
+	if (morphRange.y > morphRange.x){
+		vec3 cameraPosition = iViewMatrix[3].xyz;
+		float distance = length(vec3(worldPos.x - cameraPosition.x, cameraPosition.y, worldPos.z - cameraPosition.z));
+		morph = clamp((distance - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+	}
+	position.y = mix(aHeight, aMorphHeight, morph);
+	worldPos = modelMatrix * vec4(position, 1.0);
 	
 	UVs =  worldPos.xz / textureTiles;
 	normal = normalVec4.xyz;
@@ -12,8 +12,8 @@ if not exist bin (
 )
 
 gcc -o ./bin/renderer.exe ./src/main.c ./src/utils.c ./src/materials.c ./src/objects.c ./src/factory.c ./src/noises.c ./src/generator.c ./src/renderer.c ./src/quadtree.c ^
-./src/vbopools.c ./src/mempools.c ./src/standard.c ./src/debug.c ^
-./libs/perlin/perlin.c ^
+./src/vbopools.c ./src/mempools.c ./src/standard.c ./src/debug.c ./src/heightcache.c ./src/noisegraph.c ./src/parallel.c ./src/priorityqueue.c ./src/mpscring.c ^
+./libs/perlin/perlin.c ./libs/perlin/perlin_simd.c ./libs/perlin/simplex.c ^
 -lglew32 -lglfw3 %debugflag%  %depflag% ^
 -I".\libs\stb_image" ^
 -I".\libs\glew-2.1.0\include" ^
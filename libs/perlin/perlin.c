@@ -124,3 +124,262 @@ double pnoise3d(double x, double y, double z, double persistence, int octaves, i
 
    return total;
 }
+
+void smooth2d_row(const double *x, double frequency, double y, size_t count, int octave, int seed, double amplitude, double *accumulator) {
+    int inty = (int)y;
+    double fracy = y - inty;
+    double fy = (1 - cos(fracy * 3.141593)) * 0.5;
+    size_t i = 0;
+
+    for(i = 0; i < count; i++) {
+        double sx = x[i] * frequency;
+        int intx = (int)sx;
+        double fracx = sx - intx;
+        double fx = (1 - cos(fracx * 3.141593)) * 0.5;
+
+        double v1 = noise2d(intx, inty, octave, seed);
+        double v2 = noise2d(intx + 1, inty, octave, seed);
+        double v3 = noise2d(intx, inty + 1, octave, seed);
+        double v4 = noise2d(intx + 1, inty + 1, octave, seed);
+
+        double i1 = v1 * (1 - fx) + v2 * fx;
+        double i2 = v3 * (1 - fx) + v4 * fx;
+
+        accumulator[i] += (i1 * (1 - fy) + i2 * fy) * amplitude;
+    }
+}
+
+void pnoise2d_row_skip(const double *x, double y, size_t count, double persistence, int octaves, int seed, double skip_octaves, double *destination) {
+   double frequency = 1.0;
+   double amplitude = 1.0;
+   int first = (int)skip_octaves;
+   double first_weight = 1.0 - (skip_octaves - first);
+   size_t i = 0;
+   int o = 0;
+
+   for(i = 0; i < count; i++) {
+       destination[i] = 0.0;
+   }
+
+   for(o = 0; o < octaves; o++) {
+       if(o >= first)
+           smooth2d_row(x, frequency, y * frequency, count, o, seed, o == first ? amplitude * first_weight : amplitude, destination);
+       frequency /= 2;
+       amplitude *= persistence;
+   }
+}
+
+void pnoise2d_row(const double *x, double y, size_t count, double persistence, int octaves, int seed, double *destination) {
+   pnoise2d_row_skip(x, y, count, persistence, octaves, seed, 0.0, destination);
+}
+
+/* single precision backend: same lattice hash in unsigned arithmetic, polynomial fade instead of cosine */
+
+float rawnoisef(unsigned int n) {
+    n = (n << 13) ^ n;
+    return 1.0f - (float)((n * (n * n * 15731u + 789221u) + 1376312589u) & 0x7fffffffu) / 1073741824.0f;
+}
+
+float noise2df(int x, int y, int octave, int seed) {
+    return rawnoisef((unsigned int)x * 1619u + (unsigned int)y * 31337u + (unsigned int)octave * 3463u + (unsigned int)seed * 13397u);
+}
+
+/* odd quintic in (t - 0.5) fitted to the cosine fade: exact at 0 and 1, zero slope there, within 1e-4 in between */
+float fadef(float t) {
+    float u = fabsf(t) - 0.5f;
+    float u2 = u * u;
+    return 0.5f + u * (1.56968125f + u2 * (-2.55745f + u2 * 1.1149f));
+}
+
+float smooth2df(float x, float y, int octave, int seed) {
+    int intx = (int)x;
+    int inty = (int)y;
+    float fx = fadef(x - (float)intx);
+    float fy = fadef(y - (float)inty);
+
+    float v1 = noise2df(intx, inty, octave, seed);
+    float v2 = noise2df(intx + 1, inty, octave, seed);
+    float v3 = noise2df(intx, inty + 1, octave, seed);
+    float v4 = noise2df(intx + 1, inty + 1, octave, seed);
+
+    float i1 = v1 + (v2 - v1) * fx;
+    float i2 = v3 + (v4 - v3) * fx;
+
+    return i1 + (i2 - i1) * fy;
+}
+
+float pnoise2df(float x, float y, float persistence, int octaves, int seed) {
+   float total = 0.0f;
+   float frequency = 1.0f;
+   float amplitude = 1.0f;
+   int i = 0;
+
+   for(i = 0; i < octaves; i++) {
+       total += smooth2df(x * frequency, y * frequency, i, seed) * amplitude;
+       frequency *= 0.5f;
+       amplitude *= persistence;
+   }
+
+   return total;
+}
+
+void smooth2df_row(const float *x, float frequency, float y, size_t count, int octave, int seed, float amplitude, float *accumulator) {
+    int inty = (int)y;
+    float fy = fadef(y - (float)inty);
+    size_t i = 0;
+
+    for(i = 0; i < count; i++) {
+        float sx = x[i] * frequency;
+        int intx = (int)sx;
+        float fx = fadef(sx - (float)intx);
+
+        float v1 = noise2df(intx, inty, octave, seed);
+        float v2 = noise2df(intx + 1, inty, octave, seed);
+        float v3 = noise2df(intx, inty + 1, octave, seed);
+        float v4 = noise2df(intx + 1, inty + 1, octave, seed);
+
+        float i1 = v1 + (v2 - v1) * fx;
+        float i2 = v3 + (v4 - v3) * fx;
+
+        accumulator[i] += (i1 + (i2 - i1) * fy) * amplitude;
+    }
+}
+
+void pnoise2df_row_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination) {
+   float frequency = 1.0f;
+   float amplitude = 1.0f;
+   int first = (int)skip_octaves;
+   float first_weight = 1.0f - (skip_octaves - (float)first);
+   size_t i = 0;
+   int o = 0;
+
+   for(i = 0; i < count; i++) {
+       destination[i] = 0.0f;
+   }
+
+   for(o = 0; o < octaves; o++) {
+       if(o >= first)
+           smooth2df_row(x, frequency, y * frequency, count, o, seed, o == first ? amplitude * first_weight : amplitude, destination);
+       frequency *= 0.5f;
+       amplitude *= persistence;
+   }
+}
+
+void pnoise2df_row(const float *x, float y, size_t count, float persistence, int octaves, int seed, float *destination) {
+   pnoise2df_row_skip(x, y, count, persistence, octaves, seed, 0.0f, destination);
+}
+
+/* analytic derivatives: the same value as the plain functions, plus its partial derivatives along x and y */
+
+double smooth2d_deriv(double x, double y, int octave, int seed, double *dx, double *dy) {
+    int intx = (int)x;
+    double fracx = x - intx;
+    int inty = (int)y;
+    double fracy = y - inty;
+    double fx = (1 - cos(fracx * 3.141593)) * 0.5;
+    double fy = (1 - cos(fracy * 3.141593)) * 0.5;
+    double dfx = sin(fracx * 3.141593) * 3.141593 * 0.5;
+    double dfy = sin(fracy * 3.141593) * 3.141593 * 0.5;
+
+    double v1 = noise2d(intx, inty, octave, seed);
+    double v2 = noise2d(intx + 1, inty, octave, seed);
+    double v3 = noise2d(intx, inty + 1, octave, seed);
+    double v4 = noise2d(intx + 1, inty + 1, octave, seed);
+
+    double i1 = v1 * (1 - fx) + v2 * fx;
+    double i2 = v3 * (1 - fx) + v4 * fx;
+
+    *dx = ((v2 - v1) * (1 - fy) + (v4 - v3) * fy) * dfx;
+    *dy = (i2 - i1) * dfy;
+
+    return i1 * (1 - fy) + i2 * fy;
+}
+
+double pnoise2d_deriv(double x, double y, double persistence, int octaves, int seed, double skip_octaves, double *dx, double *dy) {
+   double total = 0.0;
+   double frequency = 1.0;
+   double amplitude = 1.0;
+   int first = (int)skip_octaves;
+   double first_weight = 1.0 - (skip_octaves - first);
+   int i = 0;
+
+   *dx = 0.0;
+   *dy = 0.0;
+
+   for(i = 0; i < octaves; i++) {
+       if(i >= first) {
+           double odx, ody;
+           double weight = i == first ? amplitude * first_weight : amplitude;
+           total += smooth2d_deriv(x * frequency, y * frequency, i, seed, &odx, &ody) * weight;
+           *dx += odx * frequency * weight;
+           *dy += ody * frequency * weight;
+       }
+       frequency /= 2;
+       amplitude *= persistence;
+   }
+
+   return total;
+}
+
+float dfadef(float t) {
+    float u = fabsf(t) - 0.5f;
+    float u2 = u * u;
+    float slope = 1.56968125f + u2 * (3.0f * -2.55745f + u2 * 5.0f * 1.1149f);
+    return t < 0.0f ? -slope : slope;
+}
+
+float smooth2df_deriv(float x, float y, int octave, int seed, float *dx, float *dy) {
+    int intx = (int)x;
+    int inty = (int)y;
+    float fracx = x - (float)intx;
+    float fracy = y - (float)inty;
+    float fx = fadef(fracx);
+    float fy = fadef(fracy);
+
+    float v1 = noise2df(intx, inty, octave, seed);
+    float v2 = noise2df(intx + 1, inty, octave, seed);
+    float v3 = noise2df(intx, inty + 1, octave, seed);
+    float v4 = noise2df(intx + 1, inty + 1, octave, seed);
+
+    float i1 = v1 + (v2 - v1) * fx;
+    float i2 = v3 + (v4 - v3) * fx;
+
+    *dx = ((v2 - v1) + ((v4 - v3) - (v2 - v1)) * fy) * dfadef(fracx);
+    *dy = (i2 - i1) * dfadef(fracy);
+
+    return i1 + (i2 - i1) * fy;
+}
+
+float pnoise2df_deriv(float x, float y, float persistence, int octaves, int seed, float skip_octaves, float *dx, float *dy) {
+   float total = 0.0f;
+   float frequency = 1.0f;
+   float amplitude = 1.0f;
+   int first = (int)skip_octaves;
+   float first_weight = 1.0f - (skip_octaves - (float)first);
+   int i = 0;
+
+   *dx = 0.0f;
+   *dy = 0.0f;
+
+   for(i = 0; i < octaves; i++) {
+       if(i >= first) {
+           float odx, ody;
+           float weight = i == first ? amplitude * first_weight : amplitude;
+           total += smooth2df_deriv(x * frequency, y * frequency, i, seed, &odx, &ody) * weight;
+           *dx += odx * frequency * weight;
+           *dy += ody * frequency * weight;
+       }
+       frequency *= 0.5f;
+       amplitude *= persistence;
+   }
+
+   return total;
+}
+
+void pnoise2df_deriv_row_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination, float *dx, float *dy) {
+   size_t i = 0;
+
+   for(i = 0; i < count; i++) {
+       destination[i] = pnoise2df_deriv(x[i], y, persistence, octaves, seed, skip_octaves, dx + i, dy + i);
+   }
+}
@@ -1,6 +1,8 @@
 #ifndef PERLIN_HEADER
 #define PERLIN_HEADER
 
+#include <stddef.h>
+
 double rawnoise(int n);
 
 double noise1d(int x, int octave, int seed);
@@ -23,4 +25,89 @@ double pnoise2d(double x, double y, double persistence, int octaves, int seed);
 
 double pnoise3d(double x, double y, double z, double persistence, int octaves, int seed);
 
+/* row variants: one y for a whole row of x coordinates, same results as the scalar calls */
+
+/* adds amplitude * smooth2d(x[i] * frequency, y, octave, seed) to accumulator[i] */
+void smooth2d_row(const double *x, double frequency, double y, size_t count, int octave, int seed, double amplitude, double *accumulator);
+
+/* destination[i] = pnoise2d(x[i], y, persistence, octaves, seed) */
+void pnoise2d_row(const double *x, double y, size_t count, double persistence, int octaves, int seed, double *destination);
+
+/*
+ * band limited variants: the finest (int)skip_octaves octaves (octave 0 first) are left out and the fractional part of
+ * skip_octaves fades the next one; skip_octaves = 0 gives the plain results bit for bit
+ */
+void pnoise2d_row_skip(const double *x, double y, size_t count, double persistence, int octaves, int seed, double skip_octaves, double *destination);
+
+/* single precision backend, float-only with a quintic fade; lattice values match the double precision functions */
+
+float rawnoisef(unsigned int n);
+
+float noise2df(int x, int y, int octave, int seed);
+
+float fadef(float t);
+
+float smooth2df(float x, float y, int octave, int seed);
+
+float pnoise2df(float x, float y, float persistence, int octaves, int seed);
+
+void smooth2df_row(const float *x, float frequency, float y, size_t count, int octave, int seed, float amplitude, float *accumulator);
+
+void pnoise2df_row(const float *x, float y, size_t count, float persistence, int octaves, int seed, float *destination);
+
+void pnoise2df_row_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination);
+
+/* SIMD row kernels (perlin_simd.c), bit-identical to pnoise2df_row; the level is detected with CPUID on first use */
+
+#define PERLIN_SIMD_NONE 0
+#define PERLIN_SIMD_SSE41 1
+#define PERLIN_SIMD_AVX2 2
+
+int perlin_simd_supported(void);
+
+int perlin_simd_level(void);
+
+/* forces a lower level (e.g. PERLIN_SIMD_NONE for the scalar fallback), clamped to what the CPU supports */
+void perlin_set_simd_level(int level);
+
+void pnoise2df_row_simd(const float *x, float y, size_t count, float persistence, int octaves, int seed, float *destination);
+
+void pnoise2df_row_simd_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination);
+
+/* analytic derivatives: return the same value as the plain functions and store its partial derivatives along x and y */
+
+double smooth2d_deriv(double x, double y, int octave, int seed, double *dx, double *dy);
+
+double pnoise2d_deriv(double x, double y, double persistence, int octaves, int seed, double skip_octaves, double *dx, double *dy);
+
+float dfadef(float t);
+
+float smooth2df_deriv(float x, float y, int octave, int seed, float *dx, float *dy);
+
+float pnoise2df_deriv(float x, float y, float persistence, int octaves, int seed, float skip_octaves, float *dx, float *dy);
+
+/* destination[i] = pnoise2df_deriv(x[i], y, ..., dx + i, dy + i), and its SIMD version, bit-identical at every level */
+void pnoise2df_deriv_row_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination, float *dx, float *dy);
+
+void pnoise2df_deriv_row_simd_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination, float *dx, float *dy);
+
+/*
+ * simplex gradient noise (simplex.c): three lattice corners per sample instead of four, permutation table hashing,
+ * floored lattice coordinates, values within [-1, 1]. The fractal sums follow the value noise layout: octave o at
+ * frequency 0.5^o, amplitude persistence^o, with the same skip_octaves semantics
+ */
+
+/* bound on |d2/dx2| and |d2/dy2| of snoise2df: three corners of at most 0.7463 each, times the normalization */
+#define SNOISE_MAX_SECOND_DERIVATIVE 222.0f
+
+float snoise2df(float x, float y, int seed);
+
+float snoise2df_deriv(float x, float y, int seed, float *dx, float *dy);
+
+float psnoise2df(float x, float y, float persistence, int octaves, int seed);
+
+void psnoise2df_row_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination);
+
+float psnoise2df_deriv(float x, float y, float persistence, int octaves, int seed, float skip_octaves, float *dx, float *dy);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include "perlin.h"
+
+/*
+ * SSE4.1 / AVX2 versions of pnoise2df_row_skip and pnoise2df_deriv. Each lane runs exactly the
+ * operations of the scalar path in the same order (no fused multiply-add), so the results are
+ * bit-identical to pnoise2df_row_skip and pnoise2df_deriv. The remainder of a row that does not
+ * fill a vector goes through the scalar lane functions.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PERLIN_X86 1
+#include <immintrin.h>
+#endif
+
+#define PERLIN_MAX_OCTAVES 32
+
+static const float fade_a = 1.56968125f;
+static const float fade_b = -2.55745f;
+static const float fade_c = 1.1149f;
+/* dfadef's, in its order of operations */
+static const float dfade_b = 3.0f * -2.55745f;
+
+/* per octave constants shared by every lane of a row */
+struct octave_row {
+    float frequency, amplitude, fy, dfy;
+    unsigned int base0, base1;
+};
+
+/* fills the rows of the octaves left after skipping, returns their count */
+static int prepare_octaves(float y, float persistence, int octaves, int seed, float skip_octaves, struct octave_row *rows) {
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    int first = (int)skip_octaves;
+    float first_weight = 1.0f - (skip_octaves - (float)first);
+    int o = 0, n = 0;
+
+    if(octaves > PERLIN_MAX_OCTAVES)
+        octaves = PERLIN_MAX_OCTAVES;
+
+    for(o = 0; o < octaves; o++) {
+        if(o >= first) {
+            float sy = y * frequency;
+            int inty = (int)sy;
+            rows[n].frequency = frequency;
+            rows[n].amplitude = o == first ? amplitude * first_weight : amplitude;
+            rows[n].fy = fadef(sy - (float)inty);
+            rows[n].dfy = dfadef(sy - (float)inty);
+            rows[n].base0 = (unsigned int)inty * 31337u + (unsigned int)o * 3463u + (unsigned int)seed * 13397u;
+            rows[n].base1 = rows[n].base0 + 31337u;
+            n++;
+        }
+        frequency *= 0.5f;
+        amplitude *= persistence;
+    }
+
+    return n;
+}
+
+static float lane_hash(unsigned int n) {
+    n = (n << 13) ^ n;
+    return 1.0f - (float)((n * (n * n * 15731u + 789221u) + 1376312589u) & 0x7fffffffu) / 1073741824.0f;
+}
+
+static float lane_noise(float x, const struct octave_row *rows, int octaves) {
+    float total = 0.0f;
+    int o = 0;
+
+    for(o = 0; o < octaves; o++) {
+        float sx = x * rows[o].frequency;
+        int intx = (int)sx;
+        float fx = fadef(sx - (float)intx);
+        unsigned int nx = (unsigned int)intx * 1619u;
+
+        float v1 = lane_hash(nx + rows[o].base0);
+        float v2 = lane_hash(nx + 1619u + rows[o].base0);
+        float v3 = lane_hash(nx + rows[o].base1);
+        float v4 = lane_hash(nx + 1619u + rows[o].base1);
+
+        float i1 = v1 + (v2 - v1) * fx;
+        float i2 = v3 + (v4 - v3) * fx;
+
+        total += (i1 + (i2 - i1) * rows[o].fy) * rows[o].amplitude;
+    }
+
+    return total;
+}
+
+static float lane_noise_deriv(float x, const struct octave_row *rows, int octaves, float *dx, float *dy) {
+    float total = 0.0f;
+    int o = 0;
+
+    *dx = 0.0f;
+    *dy = 0.0f;
+
+    for(o = 0; o < octaves; o++) {
+        float sx = x * rows[o].frequency;
+        int intx = (int)sx;
+        float fracx = sx - (float)intx;
+        float fx = fadef(fracx);
+        unsigned int nx = (unsigned int)intx * 1619u;
+
+        float v1 = lane_hash(nx + rows[o].base0);
+        float v2 = lane_hash(nx + 1619u + rows[o].base0);
+        float v3 = lane_hash(nx + rows[o].base1);
+        float v4 = lane_hash(nx + 1619u + rows[o].base1);
+
+        float i1 = v1 + (v2 - v1) * fx;
+        float i2 = v3 + (v4 - v3) * fx;
+        float odx = ((v2 - v1) + ((v4 - v3) - (v2 - v1)) * rows[o].fy) * dfadef(fracx);
+        float ody = (i2 - i1) * rows[o].dfy;
+
+        total += (i1 + (i2 - i1) * rows[o].fy) * rows[o].amplitude;
+        *dx += odx * rows[o].frequency * rows[o].amplitude;
+        *dy += ody * rows[o].frequency * rows[o].amplitude;
+    }
+
+    return total;
+}
+
+#ifdef PERLIN_X86
+
+__attribute__((target("sse4.1")))
+static __m128 hash_sse41(__m128i n) {
+    __m128i h = _mm_xor_si128(_mm_slli_epi32(n, 13), n);
+    __m128i inner = _mm_add_epi32(_mm_mullo_epi32(_mm_mullo_epi32(h, h), _mm_set1_epi32(15731)), _mm_set1_epi32(789221));
+    h = _mm_add_epi32(_mm_mullo_epi32(h, inner), _mm_set1_epi32(1376312589));
+    h = _mm_and_si128(h, _mm_set1_epi32(0x7fffffff));
+    return _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_cvtepi32_ps(h), _mm_set1_ps(1.0f / 1073741824.0f)));
+}
+
+__attribute__((target("sse4.1")))
+static __m128 fade_sse41(__m128 t) {
+    __m128 u = _mm_sub_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), t), _mm_set1_ps(0.5f));
+    __m128 u2 = _mm_mul_ps(u, u);
+    __m128 p = _mm_add_ps(_mm_set1_ps(fade_b), _mm_mul_ps(u2, _mm_set1_ps(fade_c)));
+    p = _mm_add_ps(_mm_set1_ps(fade_a), _mm_mul_ps(u2, p));
+    return _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(u, p));
+}
+
+__attribute__((target("sse4.1")))
+static void pnoise2df_row_sse41(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination) {
+    struct octave_row rows[PERLIN_MAX_OCTAVES];
+    size_t i = 0;
+    int o = 0;
+
+    octaves = prepare_octaves(y, persistence, octaves, seed, skip_octaves, rows);
+
+    for(i = 0; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 total = _mm_setzero_ps();
+
+        for(o = 0; o < octaves; o++) {
+            __m128 sx = _mm_mul_ps(vx, _mm_set1_ps(rows[o].frequency));
+            __m128i intx = _mm_cvttps_epi32(sx);
+            __m128 fx = fade_sse41(_mm_sub_ps(sx, _mm_cvtepi32_ps(intx)));
+            __m128i nx = _mm_mullo_epi32(intx, _mm_set1_epi32(1619));
+            __m128i n0 = _mm_add_epi32(nx, _mm_set1_epi32((int)rows[o].base0));
+            __m128i n1 = _mm_add_epi32(nx, _mm_set1_epi32((int)rows[o].base1));
+            __m128i step = _mm_set1_epi32(1619);
+
+            __m128 v1 = hash_sse41(n0);
+            __m128 v2 = hash_sse41(_mm_add_epi32(n0, step));
+            __m128 v3 = hash_sse41(n1);
+            __m128 v4 = hash_sse41(_mm_add_epi32(n1, step));
+
+            __m128 i1 = _mm_add_ps(v1, _mm_mul_ps(_mm_sub_ps(v2, v1), fx));
+            __m128 i2 = _mm_add_ps(v3, _mm_mul_ps(_mm_sub_ps(v4, v3), fx));
+            __m128 v = _mm_add_ps(i1, _mm_mul_ps(_mm_sub_ps(i2, i1), _mm_set1_ps(rows[o].fy)));
+
+            total = _mm_add_ps(total, _mm_mul_ps(v, _mm_set1_ps(rows[o].amplitude)));
+        }
+
+        _mm_storeu_ps(destination + i, total);
+    }
+
+    for(; i < count; i++) {
+        destination[i] = lane_noise(x[i], rows, octaves);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static __m128 dfade_sse41(__m128 t) {
+    __m128 u = _mm_sub_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), t), _mm_set1_ps(0.5f));
+    __m128 u2 = _mm_mul_ps(u, u);
+    __m128 p = _mm_add_ps(_mm_set1_ps(dfade_b), _mm_mul_ps(_mm_mul_ps(u2, _mm_set1_ps(5.0f)), _mm_set1_ps(fade_c)));
+    __m128 slope = _mm_add_ps(_mm_set1_ps(fade_a), _mm_mul_ps(u2, p));
+    return _mm_xor_ps(slope, _mm_and_ps(_mm_cmplt_ps(t, _mm_setzero_ps()), _mm_set1_ps(-0.0f)));
+}
+
+__attribute__((target("sse4.1")))
+static void pnoise2df_deriv_row_sse41(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination, float *dx, float *dy) {
+    struct octave_row rows[PERLIN_MAX_OCTAVES];
+    size_t i = 0;
+    int o = 0;
+
+    octaves = prepare_octaves(y, persistence, octaves, seed, skip_octaves, rows);
+
+    for(i = 0; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 total = _mm_setzero_ps();
+        __m128 total_dx = _mm_setzero_ps();
+        __m128 total_dy = _mm_setzero_ps();
+
+        for(o = 0; o < octaves; o++) {
+            __m128 frequency = _mm_set1_ps(rows[o].frequency);
+            __m128 amplitude = _mm_set1_ps(rows[o].amplitude);
+            __m128 fy = _mm_set1_ps(rows[o].fy);
+            __m128 sx = _mm_mul_ps(vx, frequency);
+            __m128i intx = _mm_cvttps_epi32(sx);
+            __m128 fracx = _mm_sub_ps(sx, _mm_cvtepi32_ps(intx));
+            __m128 fx = fade_sse41(fracx);
+            __m128i nx = _mm_mullo_epi32(intx, _mm_set1_epi32(1619));
+            __m128i n0 = _mm_add_epi32(nx, _mm_set1_epi32((int)rows[o].base0));
+            __m128i n1 = _mm_add_epi32(nx, _mm_set1_epi32((int)rows[o].base1));
+            __m128i step = _mm_set1_epi32(1619);
+
+            __m128 v1 = hash_sse41(n0);
+            __m128 v2 = hash_sse41(_mm_add_epi32(n0, step));
+            __m128 v3 = hash_sse41(n1);
+            __m128 v4 = hash_sse41(_mm_add_epi32(n1, step));
+
+            __m128 d12 = _mm_sub_ps(v2, v1);
+            __m128 d34 = _mm_sub_ps(v4, v3);
+            __m128 i1 = _mm_add_ps(v1, _mm_mul_ps(d12, fx));
+            __m128 i2 = _mm_add_ps(v3, _mm_mul_ps(d34, fx));
+            __m128 v = _mm_add_ps(i1, _mm_mul_ps(_mm_sub_ps(i2, i1), fy));
+            __m128 odx = _mm_mul_ps(_mm_add_ps(d12, _mm_mul_ps(_mm_sub_ps(d34, d12), fy)), dfade_sse41(fracx));
+            __m128 ody = _mm_mul_ps(_mm_sub_ps(i2, i1), _mm_set1_ps(rows[o].dfy));
+
+            total = _mm_add_ps(total, _mm_mul_ps(v, amplitude));
+            total_dx = _mm_add_ps(total_dx, _mm_mul_ps(_mm_mul_ps(odx, frequency), amplitude));
+            total_dy = _mm_add_ps(total_dy, _mm_mul_ps(_mm_mul_ps(ody, frequency), amplitude));
+        }
+
+        _mm_storeu_ps(destination + i, total);
+        _mm_storeu_ps(dx + i, total_dx);
+        _mm_storeu_ps(dy + i, total_dy);
+    }
+
+    for(; i < count; i++) {
+        destination[i] = lane_noise_deriv(x[i], rows, octaves, dx + i, dy + i);
+    }
+}
+
+__attribute__((target("avx2")))
+static __m256 hash_avx2(__m256i n) {
+    __m256i h = _mm256_xor_si256(_mm256_slli_epi32(n, 13), n);
+    __m256i inner = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_mullo_epi32(h, h), _mm256_set1_epi32(15731)), _mm256_set1_epi32(789221));
+    h = _mm256_add_epi32(_mm256_mullo_epi32(h, inner), _mm256_set1_epi32(1376312589));
+    h = _mm256_and_si256(h, _mm256_set1_epi32(0x7fffffff));
+    return _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_cvtepi32_ps(h), _mm256_set1_ps(1.0f / 1073741824.0f)));
+}
+
+__attribute__((target("avx2")))
+static __m256 fade_avx2(__m256 t) {
+    __m256 u = _mm256_sub_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), t), _mm256_set1_ps(0.5f));
+    __m256 u2 = _mm256_mul_ps(u, u);
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(fade_b), _mm256_mul_ps(u2, _mm256_set1_ps(fade_c)));
+    p = _mm256_add_ps(_mm256_set1_ps(fade_a), _mm256_mul_ps(u2, p));
+    return _mm256_add_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(u, p));
+}
+
+__attribute__((target("avx2")))
+static void pnoise2df_row_avx2(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination) {
+    struct octave_row rows[PERLIN_MAX_OCTAVES];
+    size_t i = 0;
+    int o = 0;
+
+    octaves = prepare_octaves(y, persistence, octaves, seed, skip_octaves, rows);
+
+    for(i = 0; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 total = _mm256_setzero_ps();
+
+        for(o = 0; o < octaves; o++) {
+            __m256 sx = _mm256_mul_ps(vx, _mm256_set1_ps(rows[o].frequency));
+            __m256i intx = _mm256_cvttps_epi32(sx);
+            __m256 fx = fade_avx2(_mm256_sub_ps(sx, _mm256_cvtepi32_ps(intx)));
+            __m256i nx = _mm256_mullo_epi32(intx, _mm256_set1_epi32(1619));
+            __m256i n0 = _mm256_add_epi32(nx, _mm256_set1_epi32((int)rows[o].base0));
+            __m256i n1 = _mm256_add_epi32(nx, _mm256_set1_epi32((int)rows[o].base1));
+            __m256i step = _mm256_set1_epi32(1619);
+
+            __m256 v1 = hash_avx2(n0);
+            __m256 v2 = hash_avx2(_mm256_add_epi32(n0, step));
+            __m256 v3 = hash_avx2(n1);
+            __m256 v4 = hash_avx2(_mm256_add_epi32(n1, step));
+
+            __m256 i1 = _mm256_add_ps(v1, _mm256_mul_ps(_mm256_sub_ps(v2, v1), fx));
+            __m256 i2 = _mm256_add_ps(v3, _mm256_mul_ps(_mm256_sub_ps(v4, v3), fx));
+            __m256 v = _mm256_add_ps(i1, _mm256_mul_ps(_mm256_sub_ps(i2, i1), _mm256_set1_ps(rows[o].fy)));
+
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(rows[o].amplitude)));
+        }
+
+        _mm256_storeu_ps(destination + i, total);
+    }
+
+    for(; i < count; i++) {
+        destination[i] = lane_noise(x[i], rows, octaves);
+    }
+}
+
+__attribute__((target("avx2")))
+static __m256 dfade_avx2(__m256 t) {
+    __m256 u = _mm256_sub_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), t), _mm256_set1_ps(0.5f));
+    __m256 u2 = _mm256_mul_ps(u, u);
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(dfade_b), _mm256_mul_ps(_mm256_mul_ps(u2, _mm256_set1_ps(5.0f)), _mm256_set1_ps(fade_c)));
+    __m256 slope = _mm256_add_ps(_mm256_set1_ps(fade_a), _mm256_mul_ps(u2, p));
+    return _mm256_xor_ps(slope, _mm256_and_ps(_mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_set1_ps(-0.0f)));
+}
+
+__attribute__((target("avx2")))
+static void pnoise2df_deriv_row_avx2(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination, float *dx, float *dy) {
+    struct octave_row rows[PERLIN_MAX_OCTAVES];
+    size_t i = 0;
+    int o = 0;
+
+    octaves = prepare_octaves(y, persistence, octaves, seed, skip_octaves, rows);
+
+    for(i = 0; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 total = _mm256_setzero_ps();
+        __m256 total_dx = _mm256_setzero_ps();
+        __m256 total_dy = _mm256_setzero_ps();
+
+        for(o = 0; o < octaves; o++) {
+            __m256 frequency = _mm256_set1_ps(rows[o].frequency);
+            __m256 amplitude = _mm256_set1_ps(rows[o].amplitude);
+            __m256 fy = _mm256_set1_ps(rows[o].fy);
+            __m256 sx = _mm256_mul_ps(vx, frequency);
+            __m256i intx = _mm256_cvttps_epi32(sx);
+            __m256 fracx = _mm256_sub_ps(sx, _mm256_cvtepi32_ps(intx));
+            __m256 fx = fade_avx2(fracx);
+            __m256i nx = _mm256_mullo_epi32(intx, _mm256_set1_epi32(1619));
+            __m256i n0 = _mm256_add_epi32(nx, _mm256_set1_epi32((int)rows[o].base0));
+            __m256i n1 = _mm256_add_epi32(nx, _mm256_set1_epi32((int)rows[o].base1));
+            __m256i step = _mm256_set1_epi32(1619);
+
+            __m256 v1 = hash_avx2(n0);
+            __m256 v2 = hash_avx2(_mm256_add_epi32(n0, step));
+            __m256 v3 = hash_avx2(n1);
+            __m256 v4 = hash_avx2(_mm256_add_epi32(n1, step));
+
+            __m256 d12 = _mm256_sub_ps(v2, v1);
+            __m256 d34 = _mm256_sub_ps(v4, v3);
+            __m256 i1 = _mm256_add_ps(v1, _mm256_mul_ps(d12, fx));
+            __m256 i2 = _mm256_add_ps(v3, _mm256_mul_ps(d34, fx));
+            __m256 v = _mm256_add_ps(i1, _mm256_mul_ps(_mm256_sub_ps(i2, i1), fy));
+            __m256 odx = _mm256_mul_ps(_mm256_add_ps(d12, _mm256_mul_ps(_mm256_sub_ps(d34, d12), fy)), dfade_avx2(fracx));
+            __m256 ody = _mm256_mul_ps(_mm256_sub_ps(i2, i1), _mm256_set1_ps(rows[o].dfy));
+
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, amplitude));
+            total_dx = _mm256_add_ps(total_dx, _mm256_mul_ps(_mm256_mul_ps(odx, frequency), amplitude));
+            total_dy = _mm256_add_ps(total_dy, _mm256_mul_ps(_mm256_mul_ps(ody, frequency), amplitude));
+        }
+
+        _mm256_storeu_ps(destination + i, total);
+        _mm256_storeu_ps(dx + i, total_dx);
+        _mm256_storeu_ps(dy + i, total_dy);
+    }
+
+    for(; i < count; i++) {
+        destination[i] = lane_noise_deriv(x[i], rows, octaves, dx + i, dy + i);
+    }
+}
+
+#endif
+
+int perlin_simd_supported(void) {
+#ifdef PERLIN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return PERLIN_SIMD_AVX2;
+    if(__builtin_cpu_supports("sse4.1"))
+        return PERLIN_SIMD_SSE41;
+#endif
+    return PERLIN_SIMD_NONE;
+}
+
+static int g_simd_level = -1;
+
+int perlin_simd_level(void) {
+    if(g_simd_level < 0)
+        g_simd_level = perlin_simd_supported();
+    return g_simd_level;
+}
+
+void perlin_set_simd_level(int level) {
+    int supported = perlin_simd_supported();
+    g_simd_level = level < supported ? level : supported;
+}
+
+void pnoise2df_row_simd(const float *x, float y, size_t count, float persistence, int octaves, int seed, float *destination) {
+    pnoise2df_row_simd_skip(x, y, count, persistence, octaves, seed, 0.0f, destination);
+}
+
+void pnoise2df_row_simd_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination) {
+    switch(perlin_simd_level()) {
+#ifdef PERLIN_X86
+    case PERLIN_SIMD_AVX2:
+        pnoise2df_row_avx2(x, y, count, persistence, octaves, seed, skip_octaves, destination);
+        return;
+    case PERLIN_SIMD_SSE41:
+        pnoise2df_row_sse41(x, y, count, persistence, octaves, seed, skip_octaves, destination);
+        return;
+#endif
+    default:
+        pnoise2df_row_skip(x, y, count, persistence, octaves, seed, skip_octaves, destination);
+        return;
+    }
+}
+
+void pnoise2df_deriv_row_simd_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination, float *dx, float *dy) {
+    switch(perlin_simd_level()) {
+#ifdef PERLIN_X86
+    case PERLIN_SIMD_AVX2:
+        pnoise2df_deriv_row_avx2(x, y, count, persistence, octaves, seed, skip_octaves, destination, dx, dy);
+        return;
+    case PERLIN_SIMD_SSE41:
+        pnoise2df_deriv_row_sse41(x, y, count, persistence, octaves, seed, skip_octaves, destination, dx, dy);
+        return;
+#endif
+    default:
+        pnoise2df_deriv_row_skip(x, y, count, persistence, octaves, seed, skip_octaves, destination, dx, dy);
+        return;
+    }
+}
@@ -0,0 +1,187 @@
+#include "perlin.h"
+
+/*
+ * 2D simplex gradient noise. The plane is skewed onto a triangular lattice; a sample gets contributions from the
+ * three corners of its triangle only, each a radial falloff (0.5 - r^2)^4 times the dot product of the offset with the
+ * corner's gradient. Corners are hashed through a fixed permutation table offset by the seed and pick one of 16 unit
+ * gradients. Lattice coordinates are floored, so negative coordinates are as continuous as positive ones.
+ */
+
+#define SIMPLEX_SKEW 0.366025404f     /* ( sqrt( 3 ) - 1 ) / 2 */
+#define SIMPLEX_UNSKEW 0.211324865f   /* ( 3 - sqrt( 3 ) ) / 6 */
+
+/* scales the sum of the corner contributions to about [ -1, 1 ] */
+#define SIMPLEX_NORMALIZATION 99.0f
+
+static const unsigned char permutation[256] = {
+    151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,190,6,148,
+    247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,88,237,149,56,87,174,20,125,136,171,168,68,175,
+    74,165,71,134,139,48,27,166,77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,102,143,54,
+    65,25,63,161,1,216,80,73,209,76,132,187,208,89,18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,64,
+    52,217,226,250,124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,223,183,170,213,
+    119,248,152,2,44,154,163,70,221,153,101,155,167,43,172,9,129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,
+    218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241,81,51,145,235,249,14,239,107,49,192,214,31,181,199,106,157,
+    184,84,204,176,115,121,50,45,127,4,150,254,138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
+};
+
+static const float gradients[16][2] = {
+    {0.980785280f, 0.195090322f},
+    {0.831469612f, 0.555570233f},
+    {0.555570233f, 0.831469612f},
+    {0.195090322f, 0.980785280f},
+    {-0.195090322f, 0.980785280f},
+    {-0.555570233f, 0.831469612f},
+    {-0.831469612f, 0.555570233f},
+    {-0.980785280f, 0.195090322f},
+    {-0.980785280f, -0.195090322f},
+    {-0.831469612f, -0.555570233f},
+    {-0.555570233f, -0.831469612f},
+    {-0.195090322f, -0.980785280f},
+    {0.195090322f, -0.980785280f},
+    {0.555570233f, -0.831469612f},
+    {0.831469612f, -0.555570233f},
+    {0.980785280f, -0.195090322f}
+};
+
+/* per seed offsets into the permutation table */
+struct simplex_seed {
+    unsigned int x, y;
+};
+
+static struct simplex_seed get_simplex_seed(int seed) {
+    struct simplex_seed result;
+    unsigned int h = (unsigned int)seed * 2654435761u;
+    h ^= h >> 16;
+    result.x = h & 255u;
+    result.y = (h >> 8) & 255u;
+    return result;
+}
+
+/* comparisons turned into integers rather than branches: which way they go is random from one sample to the next */
+static int fast_floor(float x) {
+    int i = (int)x;
+    return i - (int)(x < (float)i);
+}
+
+static const float *corner_gradient(int i, int j, struct simplex_seed seed) {
+    unsigned int h = permutation[((unsigned int)i + seed.x) & 255u];
+    return gradients[permutation[(h + (unsigned int)j + seed.y) & 255u] & 15u];
+}
+
+/* one corner's contribution, and its derivatives when dx is not NULL; branchless, the falloff clamps at 0 */
+static float corner(float x, float y, const float *g, float *dx, float *dy) {
+    float t = 0.5f - x * x - y * y;
+    float t2, t4, dot;
+
+    t = t > 0.0f ? t : 0.0f;
+    t2 = t * t;
+    t4 = t2 * t2;
+    dot = g[0] * x + g[1] * y;
+    if(dx) {
+        float k = 8.0f * t2 * t * dot;
+        *dx = t4 * g[0] - k * x;
+        *dy = t4 * g[1] - k * y;
+    }
+    return t4 * dot;
+}
+
+static float simplex(float x, float y, struct simplex_seed seed, float *dx, float *dy) {
+    float s = (x + y) * SIMPLEX_SKEW;
+    int i = fast_floor(x + s);
+    int j = fast_floor(y + s);
+    float t = (float)(i + j) * SIMPLEX_UNSKEW;
+    float x0 = x - ((float)i - t);
+    float y0 = y - ((float)j - t);
+    int i1 = (int)(x0 > y0);
+    int j1 = 1 - i1;
+    float x1 = x0 - (float)i1 + SIMPLEX_UNSKEW;
+    float y1 = y0 - (float)j1 + SIMPLEX_UNSKEW;
+    float x2 = x0 - 1.0f + 2.0f * SIMPLEX_UNSKEW;
+    float y2 = y0 - 1.0f + 2.0f * SIMPLEX_UNSKEW;
+    float d[6];
+
+    float n = corner(x0, y0, corner_gradient(i, j, seed), dx ? d : 0, d + 1)
+        + corner(x1, y1, corner_gradient(i + i1, j + j1, seed), dx ? d + 2 : 0, d + 3)
+        + corner(x2, y2, corner_gradient(i + 1, j + 1, seed), dx ? d + 4 : 0, d + 5);
+
+    if(dx) {
+        *dx = (d[0] + d[2] + d[4]) * SIMPLEX_NORMALIZATION;
+        *dy = (d[1] + d[3] + d[5]) * SIMPLEX_NORMALIZATION;
+    }
+    return n * SIMPLEX_NORMALIZATION;
+}
+
+float snoise2df(float x, float y, int seed) {
+    return simplex(x, y, get_simplex_seed(seed), 0, 0);
+}
+
+float snoise2df_deriv(float x, float y, int seed, float *dx, float *dy) {
+    return simplex(x, y, get_simplex_seed(seed), dx, dy);
+}
+
+/* octave o runs at frequency 0.5^o with seed + o * 3463, like the value noise octaves */
+float psnoise2df(float x, float y, float persistence, int octaves, int seed) {
+    float total = 0.0f;
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    int o = 0;
+
+    for(o = 0; o < octaves; o++) {
+        total += simplex(x * frequency, y * frequency, get_simplex_seed(seed + o * 3463), 0, 0) * amplitude;
+        frequency *= 0.5f;
+        amplitude *= persistence;
+    }
+
+    return total;
+}
+
+void psnoise2df_row_skip(const float *x, float y, size_t count, float persistence, int octaves, int seed, float skip_octaves, float *destination) {
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    int first = (int)skip_octaves;
+    float first_weight = 1.0f - (skip_octaves - (float)first);
+    size_t i = 0;
+    int o = 0;
+
+    for(i = 0; i < count; i++) {
+        destination[i] = 0.0f;
+    }
+
+    for(o = 0; o < octaves; o++) {
+        if(o >= first) {
+            struct simplex_seed octave_seed = get_simplex_seed(seed + o * 3463);
+            float weight = o == first ? amplitude * first_weight : amplitude;
+            for(i = 0; i < count; i++) {
+                destination[i] += simplex(x[i] * frequency, y * frequency, octave_seed, 0, 0) * weight;
+            }
+        }
+        frequency *= 0.5f;
+        amplitude *= persistence;
+    }
+}
+
+float psnoise2df_deriv(float x, float y, float persistence, int octaves, int seed, float skip_octaves, float *dx, float *dy) {
+    float total = 0.0f;
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    int first = (int)skip_octaves;
+    float first_weight = 1.0f - (skip_octaves - (float)first);
+    int o = 0;
+
+    *dx = 0.0f;
+    *dy = 0.0f;
+
+    for(o = 0; o < octaves; o++) {
+        if(o >= first) {
+            float weight = o == first ? amplitude * first_weight : amplitude;
+            float ddx, ddy;
+            total += simplex(x * frequency, y * frequency, get_simplex_seed(seed + o * 3463), &ddx, &ddy) * weight;
+            *dx += ddx * frequency * weight;
+            *dy += ddy * frequency * weight;
+        }
+        frequency *= 0.5f;
+        amplitude *= persistence;
+    }
+
+    return total;
+}
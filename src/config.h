@@ -2,8 +2,34 @@
 #define _CONFIG_H_
 
 #define TESSELLATIONS 3
+#define MIN_TESSELLATIONS 2
+#define MAX_TESSELLATIONS 5
+#define TESSELLATION_MAX_ERROR 0.015f
+#define TESSELLATION_DETAIL_LEVEL 3
+#define TESSELLATION_ROUGHNESS_PERCENTILE 0.9f
 #define MAX_THREADS 4
 #define MAX_PENDING_REQUESTS 500
 #define STANDARD_CHUNK_SIZE 50
+#define DEFAULT_NOISE_BACKEND NOISE_BACKEND_FAST
+#define HEIGHT_CACHE_ENTRIES ( 1 << 18 )
+#define HEIGHT_CACHE_STRIPES 64
+#define NOISE_OCTAVE_FADE_START 0.5f
+#define NOISE_OCTAVE_FADE_END 1.0f
+#define HIERARCHICAL_SYNTHESIS false
+#define HIERARCHICAL_SYNTHESIS_MAX_ERROR 0.5f
+#define PARALLEL_CHUNK_TESSELLATIONS 6
+#define PARALLEL_TILE_TESSELLATIONS 5
+#define CHUNK_SKIRTS true
+#define CHUNK_SKIRT_DEPTH 0.05f
+#define CDLOD_MORPH true
+#define CDLOD_MORPH_START 0.7f
+#define ADAPTIVE_MESH false
+#define ADAPTIVE_MESH_MAX_ERROR 0.002f
+#define VERTEX_CACHE_OPTIMIZATION true
+#define BATCH_GENERATION true
+#define GENERATION_PRIORITY_OUTSIDE_FRUSTUM 0.05f
+#define GENERATOR_POLL_BUDGET_MS 2.0f
+#define GENERATOR_POLL_BUDGET_BYTES ( 1 << 20 )
+#define GENERATOR_STATS_INTERVAL 1.0f
 
 #endif
@@ -1,7 +1,23 @@
 #include "debug.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "boolvals.h"
+#include "noises.h"
+#include "noisegraph.h"
+#include "heightcache.h"
+#include "factory.h"
+#include "parallel.h"
+#include "priorityqueue.h"
+#include "mpscring.h"
+#include "config.h"
+#include "./../libs/perlin/perlin.h"
 
 static clock_t g_chrono_last_call = 0;
 static const unsigned int threshold = 0;
@@ -18,3 +34,1557 @@ void chrono_toggle()
 		printf( "Chrono: %dms\n", count );
 	g_chrono_last_call = clock();
 }
+
+/// benchmarks
+
+// compares the fast noise backend against the reference one over chunk-sized grids spread around the origin
+static int bench_noise_deviation()
+{
+	float max_deviation = 0;
+	double mean_deviation = 0;
+	const int grids = 16;
+
+	for ( int i = 0; i < grids; ++i )
+	{
+		float grid_max, grid_mean;
+		measure_noise_backend_deviation( NOISE_BACKEND_FAST, ( i - grids / 2 ) * 2500.0f, ( i % 4 - 2 ) * 3100.0f, 9.765625f, 129, &grid_max, &grid_mean );
+		if ( grid_max > max_deviation ) max_deviation = grid_max;
+		mean_deviation += grid_mean / grids;
+	}
+
+	printf( "noise-deviation: max %f, mean %f, tolerance %f\n", max_deviation, mean_deviation, NOISE_FAST_MAX_DEVIATION );
+	return max_deviation > NOISE_FAST_MAX_DEVIATION;
+}
+
+// checks that every SIMD level the CPU supports gives the scalar fallback's terrain bit for bit, and times them
+static int bench_noise_simd()
+{
+	const size_t samples = 257;
+	const int grids = 8;
+	const enum NoiseBackend previous_backend = get_noise_backend();
+	const int supported = perlin_simd_supported();
+	float *reference = malloc( sizeof( float ) * samples * samples );
+	float *measured = malloc( sizeof( float ) * samples * samples );
+	size_t mismatches = 0;
+
+	set_noise_backend( NOISE_BACKEND_FAST );
+
+	for ( int level = PERLIN_SIMD_NONE; level <= supported; ++level )
+	{
+		clock_t elapsed = 0;
+		for ( int i = 0; i < grids; ++i )
+		{
+			float x_origin = ( i - grids / 2 ) * 2500.0f, z_origin = ( i % 3 - 1 ) * 4100.0f;
+
+			perlin_set_simd_level( PERLIN_SIMD_NONE );
+			terrain_heightmap_grid( x_origin, z_origin, 9.765625f, samples, reference, NULL );
+
+			perlin_set_simd_level( level );
+			clock_t start = clock();
+			terrain_heightmap_grid( x_origin, z_origin, 9.765625f, samples, measured, NULL );
+			elapsed += clock() - start;
+
+			if ( memcmp( reference, measured, sizeof( float ) * samples * samples ) != 0 ) ++mismatches;
+		}
+		printf( "noise-simd: level %d, %ldms for %d grids of %zu^2\n", level, ( long ) ( elapsed * 1000 / CLOCKS_PER_SEC ), grids, samples );
+	}
+
+	perlin_set_simd_level( supported );
+	set_noise_backend( previous_backend );
+	free( reference );
+	free( measured );
+
+	printf( "noise-simd: %zu mismatching grids\n", mismatches );
+	return mismatches != 0;
+}
+
+// replays a zoom-in towards the origin through the height cache: the root, then at each level the 4 children of the
+// previous level's corner chunk. Reports the share of samples served from the cache, split between levels sampled at
+// full detail and levels that fade octaves out (whose heights differ per spacing, so they only share within a level),
+// and checks them against the noise
+static int bench_height_cache()
+{
+	const float root_size = 10000;
+	const size_t max_level = 7, tessellations = 3;
+	const size_t samples = ( 1 << tessellations ) + 1;
+	float *grid = malloc( sizeof( float ) * samples * samples );
+	float *reference = malloc( sizeof( float ) * samples * samples );
+	size_t mismatches = 0;
+	size_t full_hits = 0, full_misses = 0, faded_hits = 0, faded_misses = 0;
+
+	initialize_height_cache( root_size / ( 1 << ( max_level + tessellations ) ) );
+
+	for ( size_t level = 0; level <= max_level; ++level )
+	{
+		const float size = root_size / ( 1 << level );
+		const float spacing = size / ( samples - 1 );
+		reset_height_cache_stats();
+		for ( int c = 0; c < ( level == 0 ? 1 : 4 ); ++c )
+		{
+			height_cache_grid( ( c % 2 ) * size, ( c / 2 ) * size, spacing, samples, grid, NULL );
+			terrain_heightmap_grid( ( c % 2 ) * size, ( c / 2 ) * size, spacing, samples, reference, NULL );
+			if ( memcmp( grid, reference, sizeof( float ) * samples * samples ) != 0 ) ++mismatches;
+		}
+
+		size_t level_hits, level_misses;
+		get_height_cache_stats( &level_hits, &level_misses );
+		if ( spacing <= get_terrain_full_detail_spacing() ){
+			full_hits += level_hits;
+			full_misses += level_misses;
+		}else{
+			faded_hits += level_hits;
+			faded_misses += level_misses;
+		}
+	}
+
+	const size_t hits = full_hits + faded_hits, misses = full_misses + faded_misses;
+	printf( "height-cache: %zu hits, %zu misses, %.1f%% of noise evaluations saved, %zu mismatching grids\n", hits, misses, 100.0 * hits / ( hits + misses ), mismatches );
+	if ( full_hits + full_misses > 0 )
+		printf( "  full detail levels: %.1f%% saved\n", 100.0 * full_hits / ( full_hits + full_misses ) );
+	if ( faded_hits + faded_misses > 0 )
+		printf( "  faded levels: %.1f%% saved\n", 100.0 * faded_hits / ( faded_hits + faded_misses ) );
+
+	terminate_height_cache();
+	free( grid );
+	free( reference );
+	return hits == 0 || mismatches != 0;
+}
+
+// checks the compiled builtin recipe against the hand-written ridged multifractal rows on both backends, and times them
+static int bench_noise_graph()
+{
+	const size_t samples = 257;
+	const int grids = 8;
+	const float plane_mapping_factor = 1.0f / 2048.0f;
+	const enum NoiseBackend previous_backend = get_noise_backend();
+	float *x = malloc( sizeof( float ) * samples ), *mapped_x = malloc( sizeof( float ) * samples );
+	float *reference = malloc( sizeof( float ) * samples * samples );
+	float *measured = malloc( sizeof( float ) * samples * samples );
+	size_t mismatches = 0;
+	float max_deviation = 0;
+
+	set_terrain_recipe( NULL );
+
+	for ( int backend = NOISE_BACKEND_REFERENCE; backend <= NOISE_BACKEND_FAST; ++backend )
+	{
+		clock_t hand_written = 0, compiled = 0;
+		set_noise_backend( backend );
+
+		for ( int i = 0; i < grids; ++i )
+		{
+			float x_origin = ( i - grids / 2 ) * 2500.0f, z_origin = ( i % 3 - 1 ) * 4100.0f;
+			for ( size_t s = 0; s < samples; ++s ){
+				x[ s ] = x_origin + s * 9.765625f;
+				mapped_x[ s ] = x[ s ] * plane_mapping_factor;
+			}
+
+			clock_t start = clock();
+			for ( size_t z = 0; z < samples; ++z ){
+				float *row = reference + z * samples;
+				ridged_multifractal_noise2D_row( mapped_x, ( z_origin + z * 9.765625f ) * plane_mapping_factor, samples, 415646549, 6, row );
+				for ( size_t s = 0; s < samples; ++s )
+					row[ s ] *= 128;
+			}
+			hand_written += clock() - start;
+
+			start = clock();
+			terrain_heightmap_grid( x_origin, z_origin, 9.765625f, samples, measured, NULL );
+			compiled += clock() - start;
+
+			for ( size_t s = 0; s < samples * samples; ++s ){
+				float deviation = fabsf( measured[ s ] - reference[ s ] );
+				if ( deviation > max_deviation ) max_deviation = deviation;
+			}
+			if ( backend == NOISE_BACKEND_FAST && memcmp( reference, measured, sizeof( float ) * samples * samples ) != 0 ) ++mismatches;
+		}
+		printf( "noise-graph: backend %d, hand-written %ldms, compiled %ldms\n", backend, ( long ) ( hand_written * 1000 / CLOCKS_PER_SEC ), ( long ) ( compiled * 1000 / CLOCKS_PER_SEC ) );
+	}
+
+	set_noise_backend( previous_backend );
+	free( x );
+	free( mapped_x );
+	free( reference );
+	free( measured );
+
+	printf( "noise-graph: max deviation %f, %zu fast backend grids not bit-identical\n", max_deviation, mismatches );
+	return mismatches != 0 || max_deviation > 1e-3f;
+}
+
+// checks the analytic gradients against central differences of the height function, and that the heights they come
+// with are the plain path's ones. Differences straddling a kink of a ridge or the value noise's jumps across negative
+// lattice lines (perlin.c truncates towards zero) disagree legitimately, so only their share is bounded
+static int bench_noise_gradient()
+{
+	const size_t samples = 129;
+	const float spacing = 9.765625f, h = 0.5f;
+	float *heights = malloc( sizeof( float ) * samples * samples );
+	float *plain = malloc( sizeof( float ) * samples * samples );
+	float *gradients = malloc( sizeof( float ) * samples * samples * 2 );
+	float *scalar_gradients = malloc( sizeof( float ) * samples * samples * 2 );
+	const int repeats = 10;
+	size_t height_mismatches = 0, gradient_mismatches = 0;
+	size_t disagreements = 0;
+
+	clock_t start = clock();
+	for ( int r = 0; r < repeats; ++r )
+		terrain_heightmap_grid( -1000, 2000, spacing, samples, heights, gradients );
+	clock_t gradient_elapsed = clock() - start;
+
+	start = clock();
+	for ( int r = 0; r < repeats; ++r )
+		terrain_heightmap_grid( -1000, 2000, spacing, samples, plain, NULL );
+	clock_t plain_elapsed = clock() - start;
+
+	// the SIMD derivative kernels against the scalar ones
+	const int simd_level = perlin_simd_level();
+	perlin_set_simd_level( PERLIN_SIMD_NONE );
+	start = clock();
+	for ( int r = 0; r < repeats; ++r )
+		terrain_heightmap_grid( -1000, 2000, spacing, samples, plain, scalar_gradients );
+	clock_t scalar_elapsed = clock() - start;
+	perlin_set_simd_level( simd_level );
+	for ( size_t i = 0; i < samples * samples * 2; ++i )
+		if ( gradients[ i ] != scalar_gradients[ i ] ) ++gradient_mismatches;
+
+	for ( size_t z = 0; z < samples; ++z )
+	{
+		for ( size_t x = 0; x < samples; ++x )
+		{
+			const size_t i = z * samples + x;
+			const float px = -1000 + x * spacing, pz = 2000 + z * spacing;
+			const float dx = ( terrain_heightmap_func( px + h, pz ) - terrain_heightmap_func( px - h, pz ) ) / ( 2 * h );
+			const float dz = ( terrain_heightmap_func( px, pz + h ) - terrain_heightmap_func( px, pz - h ) ) / ( 2 * h );
+
+			if ( fabsf( dx - gradients[ 2 * i ] ) > 1e-2f || fabsf( dz - gradients[ 2 * i + 1 ] ) > 1e-2f ) ++disagreements;
+			if ( heights[ i ] != plain[ i ] ) ++height_mismatches;
+		}
+	}
+
+	printf( "noise-gradient: %zu of %zu gradients disagree with central differences, %zu heights differ from the plain path\n", disagreements, samples * samples, height_mismatches );
+	printf( "noise-gradient: %ldms with gradients at SIMD level %d, %ldms without SIMD (%zu gradients differ), %ldms heights only for %d grids of %zu^2 samples\n",
+		( long ) ( gradient_elapsed * 1000 / CLOCKS_PER_SEC ), simd_level, ( long ) ( scalar_elapsed * 1000 / CLOCKS_PER_SEC ), gradient_mismatches,
+		( long ) ( plain_elapsed * 1000 / CLOCKS_PER_SEC ), repeats, samples );
+
+	free( heights );
+	free( plain );
+	free( gradients );
+	free( scalar_gradients );
+	return disagreements * 20 > samples * samples || ( get_noise_backend() == NOISE_BACKEND_FAST && height_mismatches != 0 ) || gradient_mismatches != 0;
+}
+
+// generates each quadtree level's chunks at full detail and with the octaves that level's spacing cannot resolve faded
+// out, and reports the speedup and how far the faded terrain strays from the full one
+static int bench_octave_culling()
+{
+	const float root_size = 10000;
+	const size_t max_level = 7, tessellations = 3, chunks = 1024;
+	const size_t samples = ( 1 << tessellations ) + 1;
+	float *x = malloc( sizeof( float ) * samples );
+	float *full = malloc( sizeof( float ) * samples );
+	float *culled = malloc( sizeof( float ) * samples );
+	clock_t total_full = 0, total_culled = 0;
+
+	printf( "octave-culling: full detail up to a spacing of %f\n", get_terrain_full_detail_spacing() );
+
+	for ( size_t level = 0; level <= max_level; ++level )
+	{
+		const float size = root_size / ( 1 << level );
+		const float spacing = size / ( samples - 1 );
+		clock_t elapsed_full = 0, elapsed_culled = 0;
+		double squared_error = 0, signed_error = 0;
+
+		for ( size_t c = 0; c < chunks; ++c )
+		{
+			const float x_origin = ( ( int ) ( c % 32 ) - 16 ) * size, z_origin = ( ( int ) ( c / 32 ) - 16 ) * size;
+			for ( size_t i = 0; i < samples; ++i )
+				x[ i ] = x_origin + i * spacing;
+
+			for ( size_t row = 0; row < samples; ++row )
+			{
+				clock_t start = clock();
+				terrain_heightmap_row( x, z_origin + row * spacing, samples, 0, full );
+				elapsed_full += clock() - start;
+
+				start = clock();
+				terrain_heightmap_row( x, z_origin + row * spacing, samples, spacing, culled );
+				elapsed_culled += clock() - start;
+
+				for ( size_t i = 0; i < samples; ++i ){
+					float error = culled[ i ] - full[ i ];
+					squared_error += error * error;
+					signed_error += error;
+				}
+			}
+		}
+
+		total_full += elapsed_full;
+		total_culled += elapsed_culled;
+		// the rms deviation is mostly the aliased detail removed, the mean one is the bias left by fading to expected values
+		printf( "octave-culling: level %zu, spacing %8.2f, %4ldms -> %4ldms, rms deviation %7.3f, mean deviation %7.3f\n", level, spacing,
+			( long ) ( elapsed_full * 1000 / CLOCKS_PER_SEC ), ( long ) ( elapsed_culled * 1000 / CLOCKS_PER_SEC ),
+			sqrt( squared_error / ( chunks * samples * samples ) ), signed_error / ( chunks * samples * samples ) );
+	}
+
+	printf( "octave-culling: all levels %ldms -> %ldms\n", ( long ) ( total_full * 1000 / CLOCKS_PER_SEC ), ( long ) ( total_culled * 1000 / CLOCKS_PER_SEC ) );
+
+	free( x );
+	free( full );
+	free( culled );
+	return total_culled > total_full;
+}
+
+// generates chunks down the quadtree levels from their parent's fields and at full evaluation, and checks the
+// hierarchical heights stay within the error bound they report
+static int bench_hierarchical_synthesis()
+{
+	const float root_size = 10000;
+	const size_t max_level = 7, tessellations = 3, max_chunks = 256;
+	const size_t samples = ( 1 << tessellations ) + 1;
+	float *heights = malloc( sizeof( float ) * samples * samples );
+	float *full = malloc( sizeof( float ) * samples * samples );
+	float *gradients = malloc( sizeof( float ) * samples * samples * 2 );
+	size_t out_of_bound = 0;
+	clock_t total_full = 0, total_hierarchical = 0;
+
+	// each level's chunks with their fields, children of the previous level's first ones
+	int *coords = malloc( sizeof( int ) * max_chunks * 2 ), *child_coords = malloc( sizeof( int ) * max_chunks * 2 );
+	NoiseFieldGrid **fields = calloc( max_chunks, sizeof( NoiseFieldGrid* ) ), **child_fields = calloc( max_chunks, sizeof( NoiseFieldGrid* ) );
+	size_t count = 4;
+	for ( size_t c = 0; c < count; ++c ){
+		coords[ 2 * c ] = ( int ) ( c % 2 ) - 1;
+		coords[ 2 * c + 1 ] = ( int ) ( c / 2 ) - 1;
+	}
+
+	for ( size_t level = 0; level <= max_level; ++level )
+	{
+		const float size = root_size / ( 1 << level );
+		const float spacing = size / ( samples - 1 );
+		clock_t elapsed_full = 0, elapsed_hierarchical = 0;
+		float max_error = 0, max_bound = 0;
+		size_t reused = 0;
+
+		for ( size_t c = 0; c < count; ++c )
+		{
+			const float x_origin = coords[ 2 * c ] * size, z_origin = coords[ 2 * c + 1 ] * size;
+			const NoiseFieldGrid *parent = level > 0 ? fields[ c / 4 ] : NULL;
+
+			clock_t start = clock();
+			NoiseFieldGrid *unused = terrain_heightmap_grid_hierarchical( x_origin, z_origin, spacing, samples, NULL, full, gradients );
+			elapsed_full += clock() - start;
+			delete_noise_field_grid( unused );
+
+			start = clock();
+			child_fields[ c ] = terrain_heightmap_grid_hierarchical( x_origin, z_origin, spacing, samples, parent, heights, gradients );
+			elapsed_hierarchical += clock() - start;
+
+			const float bound = get_noise_field_grid_height_error( child_fields[ c ] );
+			for ( size_t i = 0; i < samples * samples; ++i ){
+				const float error = fabsf( heights[ i ] - full[ i ] );
+				if ( error > max_error ) max_error = error;
+				if ( error > bound + 1e-3f ) ++out_of_bound;
+			}
+			if ( bound > max_bound ) max_bound = bound;
+			reused += get_noise_field_grid_reused_fields( child_fields[ c ] );
+		}
+
+		total_full += elapsed_full;
+		total_hierarchical += elapsed_hierarchical;
+		printf( "hierarchical-synthesis: level %zu, %3zu chunks, %4ldms -> %4ldms, %.2f fields reused, max error %7.4f, bound %7.4f\n", level, count,
+			( long ) ( elapsed_full * 1000 / CLOCKS_PER_SEC ), ( long ) ( elapsed_hierarchical * 1000 / CLOCKS_PER_SEC ),
+			( double ) reused / count, max_error, max_bound );
+
+		// next level: the children of the first chunks, in parent order
+		for ( size_t c = 0; c < count; ++c ){
+			delete_noise_field_grid( fields[ c ] );
+			fields[ c ] = child_fields[ c ];
+			child_fields[ c ] = NULL;
+		}
+		size_t children = count * 4 < max_chunks ? count * 4 : max_chunks;
+		for ( size_t c = 0; c < children; ++c ){
+			child_coords[ 2 * c ] = coords[ 2 * ( c / 4 ) ] * 2 + ( int ) ( c % 2 );
+			child_coords[ 2 * c + 1 ] = coords[ 2 * ( c / 4 ) + 1 ] * 2 + ( int ) ( ( c / 2 ) % 2 );
+		}
+		int *swap = coords;
+		coords = child_coords;
+		child_coords = swap;
+		count = children;
+	}
+
+	printf( "hierarchical-synthesis: all levels %ldms -> %ldms, %zu samples out of their bound\n", ( long ) ( total_full * 1000 / CLOCKS_PER_SEC ), ( long ) ( total_hierarchical * 1000 / CLOCKS_PER_SEC ), out_of_bound );
+
+	for ( size_t c = 0; c < max_chunks; ++c )
+		delete_noise_field_grid( fields[ c ] );
+	free( fields );
+	free( child_fields );
+	free( coords );
+	free( child_coords );
+	free( heights );
+	free( full );
+	free( gradients );
+	return out_of_bound != 0;
+}
+
+// times the three noises over the same rows, and checks the simplex noise against what it promises: continuous across
+// negative lattice lines (where pnoise2d's truncation jumps), analytic derivatives, and the same values through a recipe
+static int bench_noise_simplex()
+{
+	const size_t samples = 1024, rows = 256;
+	const int octaves = 4, seed = 415646549;
+	double *x = malloc( sizeof( double ) * samples ), *values = malloc( sizeof( double ) * samples );
+	float *xf = malloc( sizeof( float ) * samples ), *valuesf = malloc( sizeof( float ) * samples ), *graph = malloc( sizeof( float ) * samples );
+	for ( size_t i = 0; i < samples; ++i ){
+		x[ i ] = -40.0 + i * 0.078125;
+		xf[ i ] = x[ i ];
+	}
+
+	clock_t start = clock();
+	for ( size_t row = 0; row < rows; ++row )
+		pnoise2d_row( x, -20.0 + row * 0.15625, samples, 1, octaves, seed, values );
+	clock_t reference_elapsed = clock() - start;
+
+	start = clock();
+	for ( size_t row = 0; row < rows; ++row )
+		pnoise2df_row_simd( xf, -20.0f + row * 0.15625f, samples, 1, octaves, seed, valuesf );
+	clock_t fast_elapsed = clock() - start;
+
+	start = clock();
+	for ( size_t row = 0; row < rows; ++row )
+		pnoise2df_row( xf, -20.0f + row * 0.15625f, samples, 1, octaves, seed, valuesf );
+	clock_t scalar_elapsed = clock() - start;
+
+	start = clock();
+	for ( size_t row = 0; row < rows; ++row )
+		psnoise2df_row_skip( xf, -20.0f + row * 0.15625f, samples, 1, octaves, seed, 0, valuesf );
+	clock_t simplex_elapsed = clock() - start;
+
+	printf( "noise-simplex: %zu rows of %zu samples, %d octaves: pnoise2d %ldms, pnoise2df %ldms (simd %ldms), psnoise2df %ldms\n", rows, samples, octaves,
+		( long ) ( reference_elapsed * 1000 / CLOCKS_PER_SEC ), ( long ) ( scalar_elapsed * 1000 / CLOCKS_PER_SEC ), ( long ) ( fast_elapsed * 1000 / CLOCKS_PER_SEC ),
+		( long ) ( simplex_elapsed * 1000 / CLOCKS_PER_SEC ) );
+
+	// largest change over a 1e-3 step straddling each negative lattice line of the finest octave
+	float reference_jump = 0, simplex_jump = 0;
+	for ( int line = -40; line < 0; ++line ){
+		const float jump_reference = fabs( pnoise2d( line - 5e-4, -7.3, 1, octaves, seed ) - pnoise2d( line + 5e-4, -7.3, 1, octaves, seed ) );
+		const float jump_simplex = fabsf( psnoise2df( line - 5e-4f, -7.3f, 1, octaves, seed ) - psnoise2df( line + 5e-4f, -7.3f, 1, octaves, seed ) );
+		if ( jump_reference > reference_jump ) reference_jump = jump_reference;
+		if ( jump_simplex > simplex_jump ) simplex_jump = jump_simplex;
+	}
+	printf( "noise-simplex: largest step across a negative lattice line, pnoise2d %f, psnoise2df %f\n", reference_jump, simplex_jump );
+
+	// analytic derivatives against central differences
+	const float h = 1e-3f;
+	size_t disagreements = 0, checked = 0;
+	for ( size_t row = 0; row < 64; ++row ){
+		for ( size_t i = 0; i < samples; i += 8 ){
+			const float px = xf[ i ], pz = -20.0f + row * 0.625f;
+			float dx, dz;
+			psnoise2df_deriv( px, pz, 1, octaves, seed, 0, &dx, &dz );
+			const float fdx = ( psnoise2df( px + h, pz, 1, octaves, seed ) - psnoise2df( px - h, pz, 1, octaves, seed ) ) / ( 2 * h );
+			const float fdz = ( psnoise2df( px, pz + h, 1, octaves, seed ) - psnoise2df( px, pz - h, 1, octaves, seed ) ) / ( 2 * h );
+			if ( fabsf( dx - fdx ) > 2e-2f || fabsf( dz - fdz ) > 2e-2f ) ++disagreements;
+			++checked;
+		}
+	}
+	printf( "noise-simplex: %zu of %zu derivatives disagree with central differences\n", disagreements, checked );
+
+	// a recipe selecting it on its value node
+	size_t graph_mismatches = 0;
+	NoiseProgram *program = compile_noise_graph( "output = value seed=415646549 octaves=4 persistence=1 backend=simplex\n" );
+	if ( program == NULL ){
+		graph_mismatches = samples;
+	}else{
+		run_noise_program_row( program, xf, -7.3f, samples, 0, graph );
+		psnoise2df_row_skip( xf, -7.3f, samples, 1, octaves, seed, 0, valuesf );
+		for ( size_t i = 0; i < samples; ++i )
+			if ( graph[ i ] != valuesf[ i ] ) ++graph_mismatches;
+		delete_noise_program( program );
+	}
+	printf( "noise-simplex: %zu samples differ through a recipe\n", graph_mismatches );
+
+	free( x );
+	free( values );
+	free( xf );
+	free( valuesf );
+	free( graph );
+	return simplex_jump > 0.05f || disagreements * 100 > checked || graph_mismatches != 0;
+}
+
+// builds one large chunk serially and split across MAX_THREADS helper threads, and compares the meshes
+static boolval g_bench_helpers_running = false;
+static pthread_mutex_t g_bench_helpers_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static void *bench_helper_job( void *data )
+{
+	boolval running = true;
+	while ( running ){
+		if ( !help_parallel_loop() )
+			sched_yield();
+		pthread_mutex_lock( &g_bench_helpers_mtx );
+		running = g_bench_helpers_running;
+		pthread_mutex_unlock( &g_bench_helpers_mtx );
+	}
+	return NULL;
+}
+
+static double get_wall_seconds()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static int bench_parallel_chunk()
+{
+	const unsigned int tessellations = 9;
+	const float size = 2000;
+	float *vertices[ 2 ];
+	short *normals[ 2 ];
+	size_t vertices_count[ 2 ], normals_count[ 2 ];
+	double elapsed[ 2 ];
+	pthread_t helpers[ MAX_THREADS ];
+
+	set_parallel_loop_helpers( 0 );
+	double start = get_wall_seconds();
+	generateTessellatedQuad( -700, 300, &vertices[ 0 ], &normals[ 0 ], tessellations, size, terrain_heightmap_grid, &vertices_count[ 0 ], &normals_count[ 0 ] );
+	elapsed[ 0 ] = get_wall_seconds() - start;
+
+	g_bench_helpers_running = true;
+	for ( size_t i = 0; i < MAX_THREADS; ++i )
+		pthread_create( &helpers[ i ], NULL, bench_helper_job, NULL );
+	set_parallel_loop_helpers( MAX_THREADS );
+
+	start = get_wall_seconds();
+	generateTessellatedQuad( -700, 300, &vertices[ 1 ], &normals[ 1 ], tessellations, size, terrain_heightmap_grid, &vertices_count[ 1 ], &normals_count[ 1 ] );
+	elapsed[ 1 ] = get_wall_seconds() - start;
+
+	set_parallel_loop_helpers( 0 );
+	pthread_mutex_lock( &g_bench_helpers_mtx );
+	g_bench_helpers_running = false;
+	pthread_mutex_unlock( &g_bench_helpers_mtx );
+	for ( size_t i = 0; i < MAX_THREADS; ++i )
+		pthread_join( helpers[ i ], NULL );
+
+	// tiles start at their own origin, so heights may differ from the serial grid by rounding
+	float max_deviation = 0;
+	for ( size_t i = 0; i < vertices_count[ 0 ]; ++i ){
+		const float deviation = fabsf( vertices[ 0 ][ i ] - vertices[ 1 ][ i ] );
+		if ( deviation > max_deviation ) max_deviation = deviation;
+	}
+	for ( size_t i = 0; i < normals_count[ 0 ] * 2; ++i ){
+		const float deviation = abs( normals[ 0 ][ i ] - normals[ 1 ][ i ] ) / 32767.0f;
+		if ( deviation > max_deviation ) max_deviation = deviation;
+	}
+
+	printf( "parallel-chunk: %u tessellations, serial %.0fms, %d helper threads %.0fms, max deviation %g\n", tessellations,
+		elapsed[ 0 ] * 1000, MAX_THREADS, elapsed[ 1 ] * 1000, max_deviation );
+
+	for ( size_t i = 0; i < 2; ++i ){
+		free( vertices[ i ] );
+		free( normals[ i ] );
+	}
+	return vertices_count[ 0 ] != vertices_count[ 1 ] || max_deviation > 1e-2f;
+}
+
+// helpers blocked on a condition variable the way the generator's workers are: how much CPU they use while idle, and how
+// long a posted loop waits before one of them takes an iteration
+static pthread_mutex_t g_bench_wakeup_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_bench_wakeup_cond = PTHREAD_COND_INITIALIZER;
+static double g_bench_wakeup_posted = 0, g_bench_wakeup_picked = 0;
+static pthread_t g_bench_wakeup_poster;
+
+static void bench_wakeup()
+{
+	pthread_mutex_lock( &g_bench_wakeup_mtx );
+	pthread_cond_broadcast( &g_bench_wakeup_cond );
+	pthread_mutex_unlock( &g_bench_wakeup_mtx );
+}
+
+static void *bench_wakeup_job( void *data )
+{
+	while ( true ){
+		help_parallel_loop();
+
+		pthread_mutex_lock( &g_bench_wakeup_mtx );
+		while ( g_bench_helpers_running && !is_parallel_loop_posted() )
+			pthread_cond_wait( &g_bench_wakeup_cond, &g_bench_wakeup_mtx );
+		boolval running = g_bench_helpers_running;
+		pthread_mutex_unlock( &g_bench_wakeup_mtx );
+		if ( !running ) break;
+	}
+	return NULL;
+}
+
+// the posting thread holds its iteration until a helper has taken the other one
+static void bench_wakeup_body( void *data, size_t index )
+{
+	if ( pthread_equal( pthread_self(), g_bench_wakeup_poster ) ){
+		const double start = get_wall_seconds();
+		while ( true ){
+			pthread_mutex_lock( &g_bench_wakeup_mtx );
+			boolval picked = g_bench_wakeup_picked > 0;
+			pthread_mutex_unlock( &g_bench_wakeup_mtx );
+			if ( picked || get_wall_seconds() - start > 0.1 ) return;
+			sched_yield();
+		}
+	}
+
+	pthread_mutex_lock( &g_bench_wakeup_mtx );
+	if ( g_bench_wakeup_picked == 0 ) g_bench_wakeup_picked = get_wall_seconds();
+	pthread_mutex_unlock( &g_bench_wakeup_mtx );
+}
+
+static int bench_parallel_wakeup()
+{
+	const size_t rounds = 50;
+	pthread_t helpers[ MAX_THREADS ];
+
+	pthread_mutex_lock( &g_bench_wakeup_mtx );
+	g_bench_helpers_running = true;
+	pthread_mutex_unlock( &g_bench_wakeup_mtx );
+	for ( size_t i = 0; i < MAX_THREADS; ++i )
+		pthread_create( &helpers[ i ], NULL, bench_wakeup_job, NULL );
+	set_parallel_loop_helpers( MAX_THREADS );
+	set_parallel_loop_wakeup( bench_wakeup );
+
+	// process time, the helpers' included
+	const clock_t idle_start = clock();
+	const double idle_wall_start = get_wall_seconds();
+	struct timespec idle = { 0, 200000000 };
+	nanosleep( &idle, NULL );
+	const double idle_cpu = ( double ) ( clock() - idle_start ) / CLOCKS_PER_SEC / ( get_wall_seconds() - idle_wall_start );
+
+	double total_latency = 0, max_latency = 0;
+	size_t missed = 0;
+	g_bench_wakeup_poster = pthread_self();
+	for ( size_t i = 0; i < rounds; ++i ){
+		g_bench_wakeup_picked = 0;
+		g_bench_wakeup_posted = get_wall_seconds();
+		run_parallel_for( bench_wakeup_body, NULL, 2 );
+
+		if ( g_bench_wakeup_picked == 0 ){
+			++missed;
+			continue;
+		}
+		const double latency = g_bench_wakeup_picked - g_bench_wakeup_posted;
+		total_latency += latency;
+		if ( latency > max_latency ) max_latency = latency;
+	}
+
+	set_parallel_loop_helpers( 0 );
+	set_parallel_loop_wakeup( NULL );
+	pthread_mutex_lock( &g_bench_wakeup_mtx );
+	g_bench_helpers_running = false;
+	pthread_cond_broadcast( &g_bench_wakeup_cond );
+	pthread_mutex_unlock( &g_bench_wakeup_mtx );
+	for ( size_t i = 0; i < MAX_THREADS; ++i )
+		pthread_join( helpers[ i ], NULL );
+
+	printf( "parallel-wakeup: %d idle helper threads use %.2f%% of a core, pickup latency mean %.0fus max %.0fus, %zu of %zu rounds missed\n",
+		MAX_THREADS, idle_cpu * 100, total_latency / ( rounds - missed > 0 ? rounds - missed : 1 ) * 1e6, max_latency * 1e6, missed, rounds );
+
+	return idle_cpu > 0.01 || missed > 0;
+}
+
+// places a chunk vertex the way texturedTerrain.vert does, skirt vertices included
+static void get_chunk_vertex_position( const float *heights, size_t side, float spacing, unsigned int index, float *destination )
+{
+	size_t x = index % side, z = index / side;
+	if ( index >= side * side ){
+		const size_t edge = ( index - side * side ) / side, along = ( index - side * side ) % side;
+		x = edge == 1 ? side - 1 : edge == 3 ? 0 : along;
+		z = edge == 0 ? 0 : edge == 2 ? side - 1 : along;
+	}
+	destination[ 0 ] = x * spacing;
+	destination[ 1 ] = heights[ index ];
+	destination[ 2 ] = z * spacing;
+}
+
+// checks chunk height grids and skirts against their shared index buffer, and compares their size with six full vertices per quad
+static int bench_indexed_mesh()
+{
+	const float size = 400;
+	const float outwards[ 4 ][ 3 ] = { { 0, 0, -1 }, { 1, 0, 0 }, { 0, 0, 1 }, { -1, 0, 0 } };
+	size_t bad_triangles = 0;
+
+	for ( unsigned int tessellations = 3; tessellations <= 6; tessellations += 3 ){
+		for ( int skirts = 0; skirts < 2; ++skirts ){
+			float *vertices;
+			short *normals;
+			size_t vertices_count, normals_count, indices_count;
+			generateTessellatedQuad( 120, -80, &vertices, &normals, tessellations, size, terrain_heightmap_grid, &vertices_count, &normals_count );
+			if ( skirts )
+				addTessellatedQuadSkirts( &vertices, &normals, tessellations, size * CHUNK_SKIRT_DEPTH, &vertices_count, &normals_count );
+			unsigned int *indices = generateTessellatedQuadIndices( tessellations, skirts, &indices_count );
+
+			// every grid triangle half a quad in size and facing up, every skirt triangle facing out of its edge
+			const size_t side = ( 1 << tessellations ) + 1, grid_indices = ( side - 1 ) * ( side - 1 ) * 6;
+			const float quad_width = size / ( 1 << tessellations );
+			for ( size_t t = 0; t < indices_count; t += 3 ){
+				if ( indices[ t ] >= vertices_count || indices[ t + 1 ] >= vertices_count || indices[ t + 2 ] >= vertices_count ){
+					++bad_triangles;
+					continue;
+				}
+				float a[ 3 ], b[ 3 ], c[ 3 ];
+				get_chunk_vertex_position( vertices, side, quad_width, indices[ t ], a );
+				get_chunk_vertex_position( vertices, side, quad_width, indices[ t + 1 ], b );
+				get_chunk_vertex_position( vertices, side, quad_width, indices[ t + 2 ], c );
+				const float u[ 3 ] = { b[ 0 ] - a[ 0 ], b[ 1 ] - a[ 1 ], b[ 2 ] - a[ 2 ] }, v[ 3 ] = { c[ 0 ] - a[ 0 ], c[ 1 ] - a[ 1 ], c[ 2 ] - a[ 2 ] };
+				const float normal[ 3 ] = { u[ 1 ] * v[ 2 ] - u[ 2 ] * v[ 1 ], u[ 2 ] * v[ 0 ] - u[ 0 ] * v[ 2 ], u[ 0 ] * v[ 1 ] - u[ 1 ] * v[ 0 ] };
+				if ( t < grid_indices ){
+					if ( fabsf( normal[ 1 ] - quad_width * quad_width ) > 1e-3f * quad_width * quad_width ) ++bad_triangles;
+				}else{
+					const float *outward = outwards[ ( t - grid_indices ) / ( ( side - 1 ) * 6 ) ];
+					if ( normal[ 0 ] * outward[ 0 ] + normal[ 2 ] * outward[ 2 ] <= 0 ) ++bad_triangles;
+				}
+			}
+
+			const size_t quads = ( size_t ) 1 << ( 2 * tessellations );
+			printf( "indexed-mesh: %u tessellations%s, %zu vertices instead of %zu, %zu bytes per chunk instead of %zu, plus one %zu bytes index buffer\n",
+				tessellations, skirts ? " with skirts" : "", vertices_count, quads * 6, vertices_count * sizeof( float ) + normals_count * sizeof( short ) * 2,
+				quads * 6 * 2 * sizeof( float ) * 3, indices_count * sizeof( unsigned int ) );
+
+			free( vertices );
+			free( normals );
+			free( indices );
+		}
+	}
+
+	printf( "indexed-mesh: %zu bad triangles\n", bad_triangles );
+	return bad_triangles != 0;
+}
+
+// mirrors texturedTerrain.vert's decodeOctahedralNormal, after the GL snorm16 conversion
+static Vec3fl decode_octahedral_normal( const short *encoded )
+{
+	float x = fmaxf( encoded[ 0 ] / 32767.0f, -1 ), z = fmaxf( encoded[ 1 ] / 32767.0f, -1 );
+	Vec3fl n = { x, 1 - fabsf( x ) - fabsf( z ), z };
+	if ( n.y < 0 ){
+		n.x = ( 1 - fabsf( z ) ) * ( x >= 0 ? 1 : -1 );
+		n.z = ( 1 - fabsf( x ) ) * ( z >= 0 ? 1 : -1 );
+	}
+	const float length = sqrtf( n.x * n.x + n.y * n.y + n.z * n.z );
+	n.x /= length; n.y /= length; n.z /= length;
+	return n;
+}
+
+// round trips normals over the whole sphere through the octahedral encoding, and measures the worst angle it loses
+static int bench_octahedral_normals()
+{
+	const size_t rings = 512, segments = 1024;
+	float max_angle = 0;
+
+	for ( size_t r = 0; r <= rings; ++r ){
+		const float polar = M_PI * r / rings;
+		for ( size_t k = 0; k < segments; ++k ){
+			const float azimuth = 2 * M_PI * k / segments;
+			Vec3fl normal = { sinf( polar ) * cosf( azimuth ), cosf( polar ), sinf( polar ) * sinf( azimuth ) };
+			short encoded[ 2 ];
+			encodeOctahedralNormal( normal, encoded );
+			Vec3fl decoded = decode_octahedral_normal( encoded );
+			// the angle from the cross product, acos of a float dot product is too coarse near 0
+			const double cx = normal.y * ( double ) decoded.z - normal.z * ( double ) decoded.y,
+				cy = normal.z * ( double ) decoded.x - normal.x * ( double ) decoded.z,
+				cz = normal.x * ( double ) decoded.y - normal.y * ( double ) decoded.x;
+			const float angle = asin( fmin( sqrt( cx * cx + cy * cy + cz * cz ), 1 ) ) * 180 / M_PI;
+			if ( angle > max_angle ) max_angle = angle;
+		}
+	}
+
+	printf( "octahedral-normals: %zu directions, 4 bytes instead of 12 per normal, worst error %.4f degrees\n", ( rings + 1 ) * segments, max_angle );
+	return max_angle > 0.01f;
+}
+
+// counts the heights the factory asks for per output vertex, on the single-call and the tiled path, and what they cost:
+// each comes with its analytic gradient, which a height alone does not pay for
+static size_t g_counted_samples = 0;
+static pthread_mutex_t g_counted_samples_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static void counted_heightmap_grid( float x_origin, float z_origin, float spacing, size_t samples, float *destination, float *gradients )
+{
+	pthread_mutex_lock( &g_counted_samples_mtx );
+	g_counted_samples += samples * samples;
+	pthread_mutex_unlock( &g_counted_samples_mtx );
+	terrain_heightmap_grid( x_origin, z_origin, spacing, samples, destination, gradients );
+}
+
+static int bench_grid_sampling()
+{
+	float worst = 0;
+
+	for ( unsigned int tessellations = 3; tessellations <= 9; tessellations += 3 ){
+		float *vertices;
+		short *normals;
+		size_t vertices_count, normals_count;
+
+		g_counted_samples = 0;
+		clock_t start = clock();
+		generateTessellatedQuad( 40, 40, &vertices, &normals, tessellations, 1000, counted_heightmap_grid, &vertices_count, &normals_count );
+		const clock_t elapsed = clock() - start;
+		const float per_vertex = ( float ) g_counted_samples / vertices_count;
+		if ( per_vertex > worst ) worst = per_vertex;
+
+		const size_t samples = ( 1 << tessellations ) + 1;
+		float *heights = malloc( sizeof( float ) * samples * samples );
+		start = clock();
+		terrain_heightmap_grid( 40, 40, 1000.0f / ( samples - 1 ), samples, heights, NULL );
+		const clock_t heights_elapsed = clock() - start;
+
+		printf( "grid-sampling: %u tessellations, %zu heights for %zu vertices, %.3f per vertex, %.2fms with gradients and normals, %.2fms for the heights alone\n", tessellations,
+			g_counted_samples, vertices_count, per_vertex, elapsed * 1000.0 / CLOCKS_PER_SEC, heights_elapsed * 1000.0 / CLOCKS_PER_SEC );
+
+		free( heights );
+		free( vertices );
+		free( normals );
+	}
+
+	return worst >= 1.1f;
+}
+
+// four sibling chunks generated one by one and as one batch over their parent, with and without hierarchical synthesis:
+// samples evaluated, time, and the batch's chunks against the lone ones, which they must match exactly for the seams
+// with chunks outside the batch to close; the grandchildren of a batch's chunk, upsampled from its slice of the
+// batch's fields, must match those upsampled from the batch's fields themselves
+static int bench_batch_generation()
+{
+	const unsigned int tessellations = 5;
+	const size_t samples = ( 1 << tessellations ) + 1, batch_samples = 2 * samples - 1;
+	const float size = 312.5f, spacing = size / ( samples - 1 ), x_origin = 2500, z_origin = -1250;
+	const int repeats = 20;
+	float *heights = malloc( sizeof( float ) * samples * samples ), *gradients = malloc( sizeof( float ) * samples * samples * 2 );
+	float *batch_heights = malloc( sizeof( float ) * batch_samples * batch_samples ), *batch_gradients = malloc( sizeof( float ) * batch_samples * batch_samples * 2 );
+	float *lone_heights = malloc( sizeof( float ) * 4 * samples * samples );
+	float lone_deviation = 0, slice_deviation = 0;
+
+	NoiseFieldGrid *parent = terrain_heightmap_grid_hierarchical( x_origin, z_origin, spacing * 2, samples, NULL, heights, gradients );
+
+	clock_t start = clock();
+	for ( int r = 0; r < repeats; ++r ){
+		for ( size_t i = 0; i < 4; ++i ){
+			NoiseFieldGrid *fields = terrain_heightmap_grid_hierarchical( x_origin + i % 2 * size, z_origin + i / 2 * size, spacing, samples, parent, lone_heights + i * samples * samples, gradients );
+			delete_noise_field_grid( fields );
+		}
+	}
+	const clock_t lone = clock() - start;
+
+	start = clock();
+	NoiseFieldGrid *batch_fields = NULL;
+	for ( int r = 0; r < repeats; ++r ){
+		delete_noise_field_grid( batch_fields );
+		batch_fields = terrain_heightmap_grid_hierarchical( x_origin, z_origin, spacing, batch_samples, parent, batch_heights, batch_gradients );
+	}
+	const clock_t batched = clock() - start;
+
+	for ( size_t i = 0; i < 4; ++i ){
+		const size_t offset_x = i % 2 * ( samples - 1 ), offset_z = i / 2 * ( samples - 1 );
+		for ( size_t z = 0; z < samples; ++z )
+			for ( size_t x = 0; x < samples; ++x )
+				lone_deviation = fmaxf( lone_deviation, fabsf( lone_heights[ i * samples * samples + z * samples + x ] - batch_heights[ ( offset_z + z ) * batch_samples + offset_x + x ] ) );
+
+		// the chunk's NE grandchild, from the slice and from the whole batch
+		NoiseFieldGrid *slice = slice_noise_field_grid( batch_fields, offset_x, offset_z, samples );
+		const float child_x = x_origin + i % 2 * size + size / 2, child_z = z_origin + i / 2 * size;
+		NoiseFieldGrid *from_slice = terrain_heightmap_grid_hierarchical( child_x, child_z, spacing / 2, samples, slice, heights, gradients );
+		NoiseFieldGrid *from_batch = terrain_heightmap_grid_hierarchical( child_x, child_z, spacing / 2, samples, batch_fields, lone_heights, gradients );
+		for ( size_t k = 0; k < samples * samples; ++k )
+			slice_deviation = fmaxf( slice_deviation, fabsf( heights[ k ] - lone_heights[ k ] ) );
+		if ( get_noise_field_grid_reused_fields( from_slice ) != get_noise_field_grid_reused_fields( from_batch ) ) slice_deviation = INFINITY;
+		delete_noise_field_grid( from_slice );
+		delete_noise_field_grid( from_batch );
+		delete_noise_field_grid( slice );
+	}
+
+	printf( "batch-generation: hierarchical, 4 chunks %f s, one batch %f s, %zu samples instead of %zu, batch off the lone chunks by %f, slices off by %f\n",
+		( double ) lone / CLOCKS_PER_SEC / repeats, ( double ) batched / CLOCKS_PER_SEC / repeats, batch_samples * batch_samples, 4 * samples * samples, lone_deviation, slice_deviation );
+
+	// without hierarchical synthesis, through the same sampling as generateTessellatedQuad, at the default resolution (a
+	// batch from PARALLEL_CHUNK_TESSELLATIONS up is sampled in tiles the size of its chunks, and saves nothing there)
+	const size_t full_samples = ( 1 << TESSELLATIONS ) + 1, full_batch_samples = 2 * full_samples - 1;
+	float full_deviation = 0;
+	g_counted_samples = 0;
+	for ( size_t i = 0; i < 4; ++i )
+		sampleTessellatedQuadGrid( x_origin + i % 2 * size, z_origin + i / 2 * size, TESSELLATIONS, size, counted_heightmap_grid,
+			lone_heights + i * full_samples * full_samples, gradients + i * full_samples * full_samples * 2 );
+	const size_t lone_samples = g_counted_samples;
+	g_counted_samples = 0;
+	sampleTessellatedQuadGrid( x_origin, z_origin, TESSELLATIONS + 1, size * 2, counted_heightmap_grid, batch_heights, batch_gradients );
+	for ( size_t i = 0; i < 4; ++i ){
+		const size_t offset_x = i % 2 * ( full_samples - 1 ), offset_z = i / 2 * ( full_samples - 1 );
+		for ( size_t z = 0; z < full_samples; ++z ){
+			for ( size_t x = 0; x < full_samples; ++x ){
+				const size_t k = i * full_samples * full_samples + z * full_samples + x, b = ( offset_z + z ) * full_batch_samples + offset_x + x;
+				full_deviation = fmaxf( full_deviation, fabsf( lone_heights[ k ] - batch_heights[ b ] ) );
+				full_deviation = fmaxf( full_deviation, fabsf( gradients[ 2 * k ] - batch_gradients[ 2 * b ] ) );
+				full_deviation = fmaxf( full_deviation, fabsf( gradients[ 2 * k + 1 ] - batch_gradients[ 2 * b + 1 ] ) );
+			}
+		}
+	}
+	printf( "batch-generation: %d tessellations, height grid functions called for %zu samples instead of %zu, batch off the lone chunks by %f\n",
+		TESSELLATIONS, g_counted_samples, lone_samples, full_deviation );
+
+	delete_noise_field_grid( batch_fields );
+	delete_noise_field_grid( parent );
+	free( heights );
+	free( gradients );
+	free( batch_heights );
+	free( batch_gradients );
+	free( lone_heights );
+	return lone_deviation != 0 || slice_deviation != 0 || full_deviation != 0;
+}
+
+// height of a chunk mesh at a point given in its quads, on its NW, SW, SE / NW, SE, NE triangles
+static float get_chunk_mesh_height( const float *heights, size_t side, float x, float z )
+{
+	const size_t qx = x >= side - 1 ? side - 2 : ( size_t ) x, qz = z >= side - 1 ? side - 2 : ( size_t ) z;
+	const float fx = x - qx, fz = z - qz;
+	const float nw = heights[ qz * side + qx ], ne = heights[ qz * side + qx + 1 ], sw = heights[ ( qz + 1 ) * side + qx ], se = heights[ ( qz + 1 ) * side + qx + 1 ];
+	return fz >= fx ? nw + fz * ( sw - nw ) + fx * ( se - sw ) : nw + fx * ( ne - nw ) + fz * ( se - ne );
+}
+
+// compares a chunk, unmorphed and fully morphed, with its parent's mesh over the same ground: the pop a level switch
+// shows. Both come out of hierarchical synthesis like in the generator, the parent itself from a grandparent
+static int bench_geomorph()
+{
+	const unsigned int tessellations = 4;
+	const size_t side = ( 1 << tessellations ) + 1;
+	// levels 6 and 7 of a 10000 wide quadtree, where hierarchical synthesis reuses the parent's fields
+	const float size = 10000 / 128.0f;
+	float *parent = malloc( sizeof( float ) * side * side ), *child = malloc( sizeof( float ) * side * side );
+	float *gradients = malloc( sizeof( float ) * side * side * 2 );
+
+	// the child is the SE quarter of its parent, itself the NE quarter of the grandparent
+	NoiseFieldGrid *grandparent_fields = terrain_heightmap_grid_hierarchical( 0, 0, size * 4 / ( side - 1 ), side, NULL, child, gradients );
+	NoiseFieldGrid *parent_fields = terrain_heightmap_grid_hierarchical( size * 2, 0, size * 2 / ( side - 1 ), side, grandparent_fields, parent, gradients );
+	NoiseFieldGrid *child_fields = terrain_heightmap_grid_hierarchical( size * 3, size, size / ( side - 1 ), side, parent_fields, child, gradients );
+	const size_t child_count = side * side;
+
+	// morphing into the parent's grid, the way the generator does, into a full evaluation of the terrain, the way it
+	// did before, and into the chunk's even vertices
+	const size_t coarse_side = side / 2 + 1;
+	float *coarse = malloc( sizeof( float ) * coarse_side * coarse_side ), *evaluated = malloc( sizeof( float ) * coarse_side * coarse_side );
+	for ( size_t z = 0; z < coarse_side; ++z )
+		for ( size_t x = 0; x < coarse_side; ++x )
+			coarse[ z * coarse_side + x ] = parent[ ( side / 2 + z ) * side + side / 2 + x ];
+	terrain_heightmap_grid( size * 3, size, size / ( coarse_side - 1 ), coarse_side, evaluated, NULL );
+
+	float *full = malloc( sizeof( float ) * child_count ), *own = malloc( sizeof( float ) * child_count );
+	memcpy( full, child, sizeof( float ) * child_count );
+	memcpy( own, child, sizeof( float ) * child_count );
+	addTessellatedQuadMorphHeights( &child, tessellations, tessellations - 1, coarse, child_count );
+	addTessellatedQuadMorphHeights( &full, tessellations, tessellations - 1, evaluated, child_count );
+	addTessellatedQuadMorphHeights( &own, tessellations, tessellations - 1, NULL, child_count );
+
+	float unmorphed_pop = 0, morphed_pop = 0, full_morphed_pop = 0, own_morphed_pop = 0;
+	for ( size_t z = 0; z < side; ++z ){
+		for ( size_t x = 0; x < side; ++x ){
+			const float parent_height = get_chunk_mesh_height( parent, side, ( side - 1 ) * 0.5f + x * 0.5f, ( side - 1 ) * 0.5f + z * 0.5f );
+			unmorphed_pop = fmaxf( unmorphed_pop, fabsf( child[ z * side + x ] - parent_height ) );
+			morphed_pop = fmaxf( morphed_pop, fabsf( child[ child_count + z * side + x ] - parent_height ) );
+			full_morphed_pop = fmaxf( full_morphed_pop, fabsf( full[ child_count + z * side + x ] - parent_height ) );
+			own_morphed_pop = fmaxf( own_morphed_pop, fabsf( own[ child_count + z * side + x ] - parent_height ) );
+		}
+	}
+
+	printf( "geomorph: switching to the parent moves vertices by up to %f unmorphed, %f fully morphed (%f into a full evaluation, %f without the parent's samples)\n",
+		unmorphed_pop, morphed_pop, full_morphed_pop, own_morphed_pop );
+
+	delete_noise_field_grid( grandparent_fields );
+	delete_noise_field_grid( parent_fields );
+	delete_noise_field_grid( child_fields );
+	free( coarse );
+	free( evaluated );
+	free( full );
+	free( own );
+	free( child );
+	free( parent );
+	free( gradients );
+	return morphed_pop > 1e-3f * unmorphed_pop;
+}
+
+// children's height bounds as the quadtree takes them from their parent chunk's grid, over chunks generated the way
+// the generator does: finite once the parent is a chunk, and how far children still go past them
+static int bench_height_bounds()
+{
+	const float root_size = 10000;
+	const int chunks = 4;
+	const size_t samples = ( 1 << TESSELLATIONS ) + 1;
+	float *parent_heights = malloc( sizeof( float ) * samples * samples ), *heights = malloc( sizeof( float ) * samples * samples );
+	float *gradients = malloc( sizeof( float ) * samples * samples * 2 );
+	int failed = 0;
+
+	for ( size_t level = 1; level <= 7; ++level ){
+		const float size = root_size / pow( 2, level ), margin = size * 2 / ( samples - 1 );
+		size_t escaped = 0, total = 0;
+		float worst = 0, span = 0;
+
+		for ( int c = 0; c < chunks * chunks; ++c ){
+			const float parent_x = c % chunks * size * 2, parent_z = c / chunks * size * 2;
+			NoiseFieldGrid *parent = terrain_heightmap_grid_hierarchical( parent_x, parent_z, size * 2 / ( samples - 1 ), samples, NULL, parent_heights, gradients );
+			float min_height, max_height;
+			getTessellatedQuadHeightBounds( parent_heights, TESSELLATIONS, &min_height, &max_height );
+			if ( !isfinite( min_height ) || !isfinite( max_height ) ) failed = 1;
+			span += max_height - min_height + 2 * margin;
+
+			for ( int i = 0; i < 4; ++i ){
+				NoiseFieldGrid *fields = terrain_heightmap_grid_hierarchical( parent_x + i % 2 * size, parent_z + i / 2 * size, size / ( samples - 1 ), samples, parent, heights, gradients );
+				for ( size_t s = 0; s < samples * samples; ++s ){
+					const float past = fmaxf( min_height - margin - heights[ s ], heights[ s ] - max_height - margin );
+					if ( past > 0 ) ++escaped;
+					worst = fmaxf( worst, past );
+				}
+				total += samples * samples;
+				delete_noise_field_grid( fields );
+			}
+			delete_noise_field_grid( parent );
+		}
+
+		printf( "height-bounds: level %zu, bounds %8.2f high on average, %5.2f%% of child heights past them, by up to %f\n", level,
+			span / ( chunks * chunks ), 100.0f * escaped / total, worst );
+		if ( escaped > 0 ) failed = 1;
+	}
+
+	free( parent_heights );
+	free( heights );
+	free( gradients );
+	return failed;
+}
+
+// chunk resolutions picked from the level and the parent's roughness at each quadtree level: how far the picked meshes
+// are from the terrain and how many triangles they take next to TESSELLATIONS everywhere, which they must not exceed;
+// and geomorphing into a coarser parent class
+static int bench_tessellation_policy()
+{
+	const float root_size = 10000;
+	const int chunks = 8;
+	size_t triangles = 0, uniform_triangles = 0, over_bound = 0, over_bound_at_max = 0;
+	boolval level_over_bound_mean = false;
+
+	for ( int level = 1; level <= 7; ++level ){
+		const float size = root_size / pow( 2, level );
+		size_t picked[ MAX_TESSELLATIONS + 1 ] = { 0 }, level_over_bound = 0;
+		double mean_error = 0, uniform_mean_error = 0;
+
+		for ( int i = 0; i < chunks; ++i ){
+			const float x = ( i - chunks / 2 ) * size * 3.0f, z = ( i % 3 - 1 ) * size * 5.0f;
+
+			// the parent at the resolution its own parent, taken at TESSELLATIONS like the root, gives it
+			unsigned int parent_tessellations = TESSELLATIONS;
+			if ( level > 1 ){
+				const size_t grandparent_side = ( 1 << TESSELLATIONS ) + 1;
+				float *grandparent = malloc( sizeof( float ) * grandparent_side * grandparent_side );
+				terrain_heightmap_grid( x, z, size * 4 / ( grandparent_side - 1 ), grandparent_side, grandparent, NULL );
+				parent_tessellations = getTessellationsForRoughness( getTessellatedQuadRoughness( grandparent, TESSELLATIONS, size * 4 ), level - 1 );
+				free( grandparent );
+			}
+			const size_t parent_side = ( 1 << parent_tessellations ) + 1;
+			float *parent = malloc( sizeof( float ) * parent_side * parent_side );
+			terrain_heightmap_grid( x, z, size * 2 / ( parent_side - 1 ), parent_side, parent, NULL );
+			const unsigned int tessellations = getTessellationsForRoughness( getTessellatedQuadRoughness( parent, parent_tessellations, size * 2 ), level );
+			++picked[ tessellations ];
+			triangles += ( size_t ) 2 << ( 2 * tessellations );
+			uniform_triangles += ( size_t ) 2 << ( 2 * TESSELLATIONS );
+
+			// against the terrain sampled twice as finely as the finest class
+			const unsigned int reference_tessellations = MAX_TESSELLATIONS + 1;
+			const size_t reference_side = ( 1 << reference_tessellations ) + 1;
+			float *reference = malloc( sizeof( float ) * reference_side * reference_side );
+			terrain_heightmap_grid( x, z, size / ( reference_side - 1 ), reference_side, reference, NULL );
+			for ( int uniform = 0; uniform < 2; ++uniform ){
+				const unsigned int mesh_tessellations = uniform ? TESSELLATIONS : tessellations;
+				const size_t side = ( 1 << mesh_tessellations ) + 1;
+				float *heights = malloc( sizeof( float ) * side * side );
+				terrain_heightmap_grid( x, z, size / ( side - 1 ), side, heights, NULL );
+				const float scale = ( float ) ( side - 1 ) / ( reference_side - 1 );
+				double error = 0;
+				for ( size_t rz = 0; rz < reference_side; ++rz )
+					for ( size_t rx = 0; rx < reference_side; ++rx )
+						error += fabsf( get_chunk_mesh_height( heights, side, rx * scale, rz * scale ) - reference[ rz * reference_side + rx ] );
+				error /= reference_side * reference_side * size;
+				if ( uniform ){
+					uniform_mean_error += error / chunks;
+				}else{
+					mean_error += error / chunks;
+					if ( error > getTessellationMaxError( level ) ){
+						++level_over_bound;
+						if ( tessellations == MAX_TESSELLATIONS ) ++over_bound_at_max;
+						else ++over_bound;
+					}
+				}
+				free( heights );
+			}
+
+			free( reference );
+			free( parent );
+		}
+
+		if ( mean_error > getTessellationMaxError( level ) ) level_over_bound_mean = true;
+		printf( "tessellation-policy: level %d (%g wide), tessellations", level, size );
+		for ( int t = MIN_TESSELLATIONS; t <= MAX_TESSELLATIONS; ++t )
+			printf( " %d: %zu", t, picked[ t ] );
+		printf( ", mean error %.5f of the chunk size (%.5f at %d tessellations everywhere), %zu of %d chunks over %g\n", mean_error, uniform_mean_error,
+			TESSELLATIONS, level_over_bound, chunks, getTessellationMaxError( level ) );
+	}
+
+	// a chunk of the finest class under a parent of the coarsest, morphed into the parent's own samples
+	const unsigned int tessellations = MAX_TESSELLATIONS, parent_tessellations = MIN_TESSELLATIONS;
+	const size_t side = ( 1 << tessellations ) + 1, parent_side = ( 1 << parent_tessellations ) + 1, coarse_side = ( 1 << ( parent_tessellations - 1 ) ) + 1;
+	const float size = 625;
+	float *child, *parent, *coarse = malloc( sizeof( float ) * coarse_side * coarse_side );
+	short *child_normals, *parent_normals;
+	size_t child_count, parent_count, normals_count;
+	generateTessellatedQuad( 1250, 625, &child, &child_normals, tessellations, size, terrain_heightmap_grid, &child_count, &normals_count );
+	generateTessellatedQuad( 1250, 0, &parent, &parent_normals, parent_tessellations, size * 2, terrain_heightmap_grid, &parent_count, &normals_count );
+	terrain_heightmap_grid( 1250, 625, size / ( coarse_side - 1 ), coarse_side, coarse, NULL );
+	addTessellatedQuadMorphHeights( &child, tessellations, parent_tessellations - 1, coarse, child_count );
+
+	float morphed_pop = 0;
+	const float scale = ( float ) ( parent_side - 1 ) / ( side - 1 ) / 2;
+	for ( size_t z = 0; z < side; ++z )
+		for ( size_t x = 0; x < side; ++x )
+			morphed_pop = fmaxf( morphed_pop, fabsf( child[ child_count + z * side + x ] - get_chunk_mesh_height( parent, parent_side, x * scale, ( parent_side - 1 ) * 0.5f + z * scale ) ) );
+
+	printf( "tessellation-policy: %zu chunks over the bound at less than %d tessellations, %zu at %d; %zu triangles instead of %zu; a %u tessellations chunk under a %u tessellations parent pops by %f fully morphed\n",
+		over_bound, MAX_TESSELLATIONS, over_bound_at_max, MAX_TESSELLATIONS, triangles, uniform_triangles, tessellations, parent_tessellations, morphed_pop );
+
+	free( coarse );
+	free( child );
+	free( parent );
+	free( child_normals );
+	free( parent_normals );
+	return morphed_pop > 1e-3f || level_over_bound_mean || triangles > uniform_triangles;
+}
+
+// checks adaptive chunk meshes against their error bound: every grid vertex under a triangle within it, triangles facing up
+// and covering the chunk once, and compares their triangle counts with the full grid's
+static int bench_adaptive_mesh()
+{
+	const unsigned int tessellations = 6;
+	const size_t side = ( 1 << tessellations ) + 1;
+	const float size = 400;
+	const float quad_width = size / ( side - 1 );
+	const float max_errors[] = { 0, 0.0005f, 0.002f, 0.01f };
+	float *vertices;
+	short *normals;
+	size_t vertices_count, normals_count;
+	size_t bad_triangles = 0;
+	float worst_ratio = 0;
+
+	generateTessellatedQuad( 120, -80, &vertices, &normals, tessellations, size, terrain_heightmap_grid, &vertices_count, &normals_count );
+	clock_t start = clock();
+	float *errors = computeTessellatedQuadErrors( vertices, tessellations );
+	const double errors_seconds = ( double ) ( clock() - start ) / CLOCKS_PER_SEC;
+
+	for ( size_t e = 0; e < sizeof( max_errors ) / sizeof( max_errors[ 0 ] ); ++e ){
+		const float max_error = max_errors[ e ] * size;
+		size_t indices_count;
+		unsigned int *indices = generateTessellatedQuadAdaptiveIndices( errors, tessellations, max_error, false, &indices_count );
+
+		// in grid units: x along columns, z along rows
+		float worst_error = 0;
+		double area = 0;
+		for ( size_t t = 0; t < indices_count; t += 3 ){
+			const int ax = indices[ t ] % side, az = indices[ t ] / side, bx = indices[ t + 1 ] % side, bz = indices[ t + 1 ] / side,
+				cx = indices[ t + 2 ] % side, cz = indices[ t + 2 ] / side;
+			// counterclockwise seen from above (y up, z towards the viewer) is a negative cross product in the xz plane
+			const int doubled_area = ( bx - ax ) * ( cz - az ) - ( bz - az ) * ( cx - ax );
+			if ( doubled_area >= 0 ){
+				++bad_triangles;
+				continue;
+			}
+			area -= doubled_area / 2.0;
+
+			const int min_x = fmin( ax, fmin( bx, cx ) ), max_x = fmax( ax, fmax( bx, cx ) ), min_z = fmin( az, fmin( bz, cz ) ), max_z = fmax( az, fmax( bz, cz ) );
+			for ( int z = min_z; z <= max_z; ++z ){
+				for ( int x = min_x; x <= max_x; ++x ){
+					const float wa = ( float ) ( ( bx - x ) * ( cz - z ) - ( bz - z ) * ( cx - x ) ) / doubled_area,
+						wb = ( float ) ( ( cx - x ) * ( az - z ) - ( cz - z ) * ( ax - x ) ) / doubled_area,
+						wc = 1 - wa - wb;
+					if ( wa < -1e-6f || wb < -1e-6f || wc < -1e-6f ) continue;
+					const float interpolated = wa * vertices[ indices[ t ] ] + wb * vertices[ indices[ t + 1 ] ] + wc * vertices[ indices[ t + 2 ] ];
+					worst_error = fmaxf( worst_error, fabsf( interpolated - vertices[ z * side + x ] ) );
+				}
+			}
+		}
+		if ( fabs( area - ( side - 1 ) * ( side - 1 ) ) > 1e-6 ) ++bad_triangles;
+		if ( max_error > 0 ) worst_ratio = fmaxf( worst_ratio, worst_error / max_error );
+		else if ( worst_error > 0 || indices_count != ( side - 1 ) * ( side - 1 ) * 6 ) ++bad_triangles;
+
+		printf( "adaptive-mesh: max error %g (%g quads), %zu triangles instead of %zu, worst vertex off by %f\n",
+			max_error, max_error / quad_width, indices_count / 3, ( side - 1 ) * ( side - 1 ) * 2, worst_error );
+		free( indices );
+	}
+
+	printf( "adaptive-mesh: errors computed in %f s, %zu bad triangles, worst error %f of the bound\n", errors_seconds, bad_triangles, worst_ratio );
+
+	free( errors );
+	free( vertices );
+	free( normals );
+	return bad_triangles != 0 || worst_ratio > 1.0001f;
+}
+
+// vertex shader runs for a triangle list through a FIFO post-transform cache of that many entries
+static size_t simulate_vertex_cache( const unsigned int *indices, size_t indices_count, size_t entries )
+{
+	unsigned int cache[ 64 ];
+	size_t cached = 0, next = 0, misses = 0;
+
+	for ( size_t i = 0; i < indices_count; ++i ){
+		boolval hit = false;
+		for ( size_t c = 0; c < cached && !hit; ++c )
+			hit = cache[ c ] == indices[ i ];
+		if ( hit ) continue;
+		++misses;
+		cache[ next ] = indices[ i ];
+		next = ( next + 1 ) % entries;
+		if ( cached < entries ) ++cached;
+	}
+	return misses;
+}
+
+static size_t count_referenced_vertices( const unsigned int *indices, size_t indices_count )
+{
+	size_t vertices = 0, referenced = 0;
+	for ( size_t i = 0; i < indices_count; ++i )
+		if ( indices[ i ] >= vertices ) vertices = indices[ i ] + 1;
+	boolval *seen = calloc( vertices, sizeof( boolval ) );
+	for ( size_t i = 0; i < indices_count; ++i ){
+		if ( !seen[ indices[ i ] ] ) ++referenced;
+		seen[ indices[ i ] ] = true;
+	}
+	free( seen );
+	return referenced;
+}
+
+// triangles rotated to start at their smallest index, which keeps their winding, then sorted
+static int compare_triangles( const void *a, const void *b )
+{
+	const unsigned int *u = a, *v = b;
+	for ( size_t k = 0; k < 3; ++k )
+		if ( u[ k ] != v[ k ] ) return u[ k ] < v[ k ] ? -1 : 1;
+	return 0;
+}
+
+static unsigned int *get_sorted_triangles( const unsigned int *indices, size_t indices_count )
+{
+	unsigned int *triangles = malloc( sizeof( unsigned int ) * indices_count );
+	for ( size_t t = 0; t < indices_count; t += 3 ){
+		size_t first = indices[ t ] < indices[ t + 1 ] ? ( indices[ t ] < indices[ t + 2 ] ? 0 : 2 ) : ( indices[ t + 1 ] < indices[ t + 2 ] ? 1 : 2 );
+		for ( size_t k = 0; k < 3; ++k )
+			triangles[ t + k ] = indices[ t + ( first + k ) % 3 ];
+	}
+	qsort( triangles, indices_count / 3, sizeof( unsigned int ) * 3, compare_triangles );
+	return triangles;
+}
+
+// ACMR (vertex shader runs per triangle) and ATVR (runs per vertex, 1 at best) of chunk index lists before and after
+// optimizeVertexCacheOrder, for FIFO caches of 16 and 32 entries; the triangles must stay the same
+static int bench_vertex_cache()
+{
+	const char *names[] = { "3 tessellations", "6 tessellations", "6 tessellations adaptive" };
+	const size_t cache_sizes[] = { 16, 32 };
+	size_t changed_triangles = 0;
+	double worst_gain = INFINITY;
+
+	float *vertices;
+	short *normals;
+	size_t vertices_count, normals_count;
+	generateTessellatedQuad( 120, -80, &vertices, &normals, 6, 400, terrain_heightmap_grid, &vertices_count, &normals_count );
+	float *errors = computeTessellatedQuadErrors( vertices, 6 );
+
+	for ( size_t layout = 0; layout < 3; ++layout ){
+		size_t indices_count;
+		unsigned int *indices = layout == 2 ? generateTessellatedQuadAdaptiveIndices( errors, 6, 400 * 0.002f, true, &indices_count )
+			: generateTessellatedQuadIndices( layout == 0 ? 3 : 6, true, &indices_count );
+		unsigned int *optimized = malloc( sizeof( unsigned int ) * indices_count );
+		memcpy( optimized, indices, sizeof( unsigned int ) * indices_count );
+
+		clock_t start = clock();
+		optimizeVertexCacheOrder( optimized, indices_count );
+		const double seconds = ( double ) ( clock() - start ) / CLOCKS_PER_SEC;
+
+		unsigned int *before = get_sorted_triangles( indices, indices_count ), *after = get_sorted_triangles( optimized, indices_count );
+		for ( size_t t = 0; t < indices_count; t += 3 )
+			if ( compare_triangles( before + t, after + t ) != 0 ) ++changed_triangles;
+
+		const size_t triangles = indices_count / 3, referenced = count_referenced_vertices( indices, indices_count );
+		for ( size_t c = 0; c < 2; ++c ){
+			const size_t row_order = simulate_vertex_cache( indices, indices_count, cache_sizes[ c ] );
+			const size_t reordered = simulate_vertex_cache( optimized, indices_count, cache_sizes[ c ] );
+			printf( "vertex-cache: %s, %zu entries: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %zu -> %zu vertex shader runs per chunk\n",
+				names[ layout ], cache_sizes[ c ], ( double ) row_order / triangles, ( double ) reordered / triangles,
+				( double ) row_order / referenced, ( double ) reordered / referenced, row_order, reordered );
+			worst_gain = fmin( worst_gain, ( double ) row_order / reordered );
+		}
+		printf( "vertex-cache: %s, %zu triangles reordered in %f s\n", names[ layout ], triangles, seconds );
+
+		free( before );
+		free( after );
+		free( optimized );
+		free( indices );
+	}
+
+	printf( "vertex-cache: %zu changed triangles, vertex shader runs divided by at least %.2f\n", changed_triangles, worst_gain );
+
+	free( errors );
+	free( vertices );
+	free( normals );
+	return changed_triangles != 0 || worst_gain <= 1;
+}
+
+// checks the generator's request queue against a brute force search over random pushes, priority changes, removals and
+// rebuilds, and compares how many of 500 requests go before the most important tenth is done, in slot order and by priority
+static unsigned int g_bench_random_state = 12345;
+
+static unsigned int bench_random()
+{
+	g_bench_random_state = g_bench_random_state * 1664525u + 1013904223u;
+	return g_bench_random_state >> 8;
+}
+
+static float bench_item_priority( int item, void *data )
+{
+	return ( ( unsigned int ) item * 2654435761u >> 8 ) / 16777216.0f + *( float* ) data;
+}
+
+static int bench_priority_queue()
+{
+	const size_t capacity = MAX_PENDING_REQUESTS, operations = 200000;
+	PriorityQueue *queue = create_priority_queue( capacity );
+	float *priorities = malloc( sizeof( float ) * capacity );
+	boolval *queued = calloc( capacity, sizeof( boolval ) );
+	size_t mismatches = 0, length = 0;
+
+	for ( size_t i = 0; i < operations; ++i ){
+		const unsigned int operation = bench_random() % 8;
+		const int item = bench_random() % capacity;
+
+		if ( i % 1000 == 999 ){
+			float offset = i;
+			reprioritize_priority_queue( queue, bench_item_priority, &offset );
+			for ( size_t j = 0; j < capacity; ++j )
+				if ( queued[ j ] ) priorities[ j ] = bench_item_priority( j, &offset );
+		}else if ( operation < 4 ){
+			priorities[ item ] = ( bench_random() % 1000 ) / 10.0f;
+			push_priority_queue( queue, item, priorities[ item ] );
+			if ( !queued[ item ] ) ++length;
+			queued[ item ] = true;
+		}else if ( operation < 6 ){
+			if ( remove_priority_queue( queue, item ) != queued[ item ] ) ++mismatches;
+			if ( queued[ item ] ) --length;
+			queued[ item ] = false;
+		}else{
+			const int popped = pop_priority_queue( queue );
+			float best = -1;
+			for ( size_t j = 0; j < capacity; ++j )
+				if ( queued[ j ] && priorities[ j ] > best ) best = priorities[ j ];
+			if ( popped == -1 ? length != 0 : !queued[ popped ] || priorities[ popped ] != best ) ++mismatches;
+			if ( popped != -1 ){
+				queued[ popped ] = false;
+				--length;
+			}
+		}
+
+		if ( get_priority_queue_length( queue ) != length ) ++mismatches;
+	}
+
+	// a teleport: every slot requested at once, a tenth of the chunks in view
+	while ( pop_priority_queue( queue ) != -1 );
+	size_t in_view = 0;
+	for ( size_t i = 0; i < capacity; ++i ){
+		priorities[ i ] = bench_random() % 10 == 0 ? 1.0f + ( bench_random() % 1000 ) / 1000.0f : ( bench_random() % 1000 ) / 1000.0f;
+		if ( priorities[ i ] >= 1.0f ) ++in_view;
+		push_priority_queue( queue, i, priorities[ i ] );
+	}
+	size_t slot_order_done = 0, priority_done = 0, seen = 0;
+	for ( size_t i = 0; i < capacity && seen < in_view; ++i )
+		if ( priorities[ i ] >= 1.0f ) slot_order_done = i + 1, ++seen;
+	for ( seen = 0; seen < in_view; ++priority_done )
+		if ( priorities[ pop_priority_queue( queue ) ] >= 1.0f ) ++seen;
+
+	printf( "priority-queue: %zu operations, %zu mismatches, %zu chunks in view done after %zu jobs in slot order, %zu by priority\n",
+		operations, mismatches, in_view, slot_order_done, priority_done );
+
+	delete_priority_queue( queue );
+	free( priorities );
+	free( queued );
+	return mismatches != 0 || priority_done != in_view;
+}
+
+// hands results from 4, 8 and 16 producer threads to one consumer through the lock-free completion ring, and through a
+// mutex guarded FIFO the way finished requests used to be handed back; every producer's results have to arrive in order.
+// Which one is faster depends on the core count, the numbers are only meaningful with at least as many cores as workers
+#define BENCH_COMPLETION_RESULTS 200000
+#define BENCH_COMPLETION_CAPACITY 512
+
+struct bench_completion {
+	int producer;
+	size_t sequence;
+	void *payload[ 6 ]; // the size of a finished request's description
+};
+
+struct bench_completion_producer {
+	int producer;
+	size_t results;
+	boolval lock_free;
+};
+
+static MpscRing *g_bench_completion_ring = NULL;
+static pthread_mutex_t g_bench_completion_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct bench_completion g_bench_completion_fifo[ BENCH_COMPLETION_CAPACITY ];
+static size_t g_bench_completion_head = 0, g_bench_completion_length = 0;
+
+static void *bench_completion_job( void *data )
+{
+	const struct bench_completion_producer *producer = data;
+
+	for ( size_t i = 0; i < producer->results; ++i ){
+		struct bench_completion completion = { producer->producer, i, { NULL } };
+
+		while ( true ){
+			boolval pushed;
+			if ( producer->lock_free ){
+				pushed = push_mpsc_ring( g_bench_completion_ring, &completion );
+			}else{
+				pthread_mutex_lock( &g_bench_completion_mtx );
+				pushed = g_bench_completion_length < BENCH_COMPLETION_CAPACITY;
+				if ( pushed )
+					g_bench_completion_fifo[ ( g_bench_completion_head + g_bench_completion_length++ ) % BENCH_COMPLETION_CAPACITY ] = completion;
+				pthread_mutex_unlock( &g_bench_completion_mtx );
+			}
+			if ( pushed ) break;
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+// runs the producers and drains their results, returns how many arrived out of order; pop_time is the mean time the
+// consumer spends per result taken, what a frame would pay
+static size_t run_completion_producers( size_t producers, boolval lock_free, double *elapsed, double *pop_time )
+{
+	pthread_t threads[ 16 ];
+	struct bench_completion_producer states[ 16 ];
+	size_t next_sequence[ 16 ] = { 0 }, disorders = 0;
+
+	g_bench_completion_ring = create_mpsc_ring( BENCH_COMPLETION_CAPACITY, sizeof( struct bench_completion ) );
+	g_bench_completion_head = g_bench_completion_length = 0;
+	*pop_time = 0;
+
+	const double start = get_wall_seconds();
+	for ( size_t i = 0; i < producers; ++i ){
+		states[ i ].producer = i;
+		states[ i ].results = BENCH_COMPLETION_RESULTS / producers;
+		states[ i ].lock_free = lock_free;
+		pthread_create( &threads[ i ], NULL, bench_completion_job, &states[ i ] );
+	}
+
+	const size_t total = BENCH_COMPLETION_RESULTS / producers * producers;
+	for ( size_t received = 0; received < total; ){
+		struct bench_completion completion;
+		const double pop_start = get_wall_seconds();
+		boolval popped;
+		if ( lock_free ){
+			popped = pop_mpsc_ring( g_bench_completion_ring, &completion );
+		}else{
+			pthread_mutex_lock( &g_bench_completion_mtx );
+			popped = g_bench_completion_length > 0;
+			if ( popped ){
+				completion = g_bench_completion_fifo[ g_bench_completion_head ];
+				g_bench_completion_head = ( g_bench_completion_head + 1 ) % BENCH_COMPLETION_CAPACITY;
+				--g_bench_completion_length;
+			}
+			pthread_mutex_unlock( &g_bench_completion_mtx );
+		}
+		*pop_time += get_wall_seconds() - pop_start;
+
+		if ( !popped ){
+			sched_yield();
+			continue;
+		}
+		if ( completion.sequence != next_sequence[ completion.producer ] ) ++disorders;
+		next_sequence[ completion.producer ] = completion.sequence + 1;
+		++received;
+	}
+	*elapsed = get_wall_seconds() - start;
+	*pop_time /= total;
+
+	for ( size_t i = 0; i < producers; ++i )
+		pthread_join( threads[ i ], NULL );
+	delete_mpsc_ring( g_bench_completion_ring );
+	g_bench_completion_ring = NULL;
+
+	return disorders;
+}
+
+static int bench_completion_ring()
+{
+	const size_t producer_counts[] = { 4, 8, 16 };
+	size_t disorders = 0;
+
+	for ( size_t i = 0; i < 3; ++i ){
+		double elapsed[ 2 ], pop_time[ 2 ];
+		disorders += run_completion_producers( producer_counts[ i ], false, &elapsed[ 0 ], &pop_time[ 0 ] );
+		disorders += run_completion_producers( producer_counts[ i ], true, &elapsed[ 1 ], &pop_time[ 1 ] );
+
+		printf( "completion-ring: %2zu workers, mutex %.2fM results/s %.0fns per pop, lock-free %.2fM results/s %.0fns per pop\n",
+			producer_counts[ i ],
+			BENCH_COMPLETION_RESULTS / elapsed[ 0 ] * 1e-6, pop_time[ 0 ] * 1e9,
+			BENCH_COMPLETION_RESULTS / elapsed[ 1 ] * 1e-6, pop_time[ 1 ] * 1e9 );
+	}
+	printf( "completion-ring: %zu results out of order\n", disorders );
+
+	return disorders != 0;
+}
+
+struct debug_benchmark {
+	const char *name;
+	int ( *run )();
+};
+
+static const struct debug_benchmark g_benchmarks[] = {
+	{ "noise-deviation", bench_noise_deviation },
+	{ "noise-simd", bench_noise_simd },
+	{ "height-cache", bench_height_cache },
+	{ "noise-graph", bench_noise_graph },
+	{ "noise-gradient", bench_noise_gradient },
+	{ "octave-culling", bench_octave_culling },
+	{ "hierarchical-synthesis", bench_hierarchical_synthesis },
+	{ "noise-simplex", bench_noise_simplex },
+	{ "parallel-chunk", bench_parallel_chunk },
+	{ "parallel-wakeup", bench_parallel_wakeup },
+	{ "indexed-mesh", bench_indexed_mesh },
+	{ "octahedral-normals", bench_octahedral_normals },
+	{ "grid-sampling", bench_grid_sampling },
+	{ "geomorph", bench_geomorph },
+	{ "batch-generation", bench_batch_generation },
+	{ "height-bounds", bench_height_bounds },
+	{ "tessellation-policy", bench_tessellation_policy },
+	{ "adaptive-mesh", bench_adaptive_mesh },
+	{ "vertex-cache", bench_vertex_cache },
+	{ "priority-queue", bench_priority_queue },
+	{ "completion-ring", bench_completion_ring }
+};
+
+int run_debug_benchmark( const char *name )
+{
+	int failures = 0;
+	boolval found = false;
+
+	// the benchmarks sample the builtin terrain, and run their own threads
+	set_terrain_recipe( NULL );
+
+	for ( size_t i = 0; i < sizeof( g_benchmarks ) / sizeof( g_benchmarks[ 0 ] ); ++i )
+	{
+		if ( strcmp( name, "all" ) != 0 && strcmp( name, g_benchmarks[ i ].name ) != 0 ) continue;
+		found = true;
+		if ( g_benchmarks[ i ].run() ){
+			printf( "%s: FAILED\n", g_benchmarks[ i ].name );
+			++failures;
+		}
+	}
+
+	if ( !found ){
+		fprintf( stderr, "Unknown benchmark %s\n", name );
+		return 1;
+	}
+	return failures;
+}
@@ -4,4 +4,7 @@
 void chrono_zero();
 void chrono_toggle();
 
+// runs a headless benchmark or check by name ("all" runs every one), returns non-zero on failure
+int run_debug_benchmark( const char *name );
+
 #endif
@@ -5,300 +5,670 @@
 #include <math.h>
 
 #include "utils.h"
-
-Vec3fl neighborNormalsAverage(Vec3fl *a, Vec3fl *b, Vec3fl *c, Vec3fl *d)
+#include "parallel.h"
+#include "config.h"
+
+// chunks from PARALLEL_CHUNK_TESSELLATIONS up are sampled in square tiles and assembled in rows, as parallel loops (see parallel.h)
+struct gridTilesJob {
+	float xCoordsOffset, zCoordsOffset, smallestWidth;
+	size_t sideVerticesAmount, tileQuadsAmount, sideTilesAmount;
+	void(*heightGridFunction)(float, float, float, size_t, float*, float*);
+	float *heightGrid, *gradientGrid;
+};
+
+// samples one tile, and keeps the samples it owns: its last row and column belong to the next tiles, except on the grid's edge
+static void sampleGridTile(void *data, size_t tileIndex)
 {
-	Vec3fl normal = {0, 0, 0};
-	size_t count = 0;
-
-	if (a != NULL){
-		++count;
-		normal = vec3fl_add(normal, *a);
-	}
+	const struct gridTilesJob *job = data;
+	const size_t tileX = tileIndex % job->sideTilesAmount, tileZ = tileIndex / job->sideTilesAmount;
+	const size_t tileVerticesAmount = job->tileQuadsAmount + 1;
+
+	float* tileHeights = malloc(tileVerticesAmount*tileVerticesAmount*sizeof(float));
+	float* tileGradients = malloc(tileVerticesAmount*tileVerticesAmount*sizeof(float)*2);
+	job->heightGridFunction(
+		job->xCoordsOffset + tileX*job->tileQuadsAmount*job->smallestWidth,
+		job->zCoordsOffset + tileZ*job->tileQuadsAmount*job->smallestWidth,
+		job->smallestWidth, tileVerticesAmount, tileHeights, tileGradients
+	);
 
-	if (b != NULL){
-		++count;
-		normal = vec3fl_add(normal, *b);
+	const size_t ownedX = tileX + 1 == job->sideTilesAmount ? tileVerticesAmount : job->tileQuadsAmount;
+	const size_t ownedZ = tileZ + 1 == job->sideTilesAmount ? tileVerticesAmount : job->tileQuadsAmount;
+	for (size_t z = 0; z < ownedZ; ++z){
+		size_t gridIndex = (tileZ*job->tileQuadsAmount + z)*job->sideVerticesAmount + tileX*job->tileQuadsAmount;
+		for (size_t x = 0; x < ownedX; ++x){
+			job->heightGrid[gridIndex + x] = tileHeights[z*tileVerticesAmount + x];
+			job->gradientGrid[2*(gridIndex + x)] = tileGradients[2*(z*tileVerticesAmount + x)];
+			job->gradientGrid[2*(gridIndex + x) + 1] = tileGradients[2*(z*tileVerticesAmount + x) + 1];
+		}
 	}
 
-	if (c != NULL){
-		++count;
-		normal = vec3fl_add(normal, *c);
-	}
+	free(tileGradients);
+	free(tileHeights);
+}
 
-	if (d != NULL){
-		++count;
-		normal = vec3fl_add(normal, *d);
+void sampleTessellatedQuadGrid(
+	float xCoordsOffset,
+	float zCoordsOffset,
+	unsigned int tessellations, 
+	float size, 
+	void(*heightGridFunction)(float, float, float, size_t, float*, float*),
+	float* heightGrid,
+	float* gradientGrid
+)
+{
+	const size_t sideVerticesAmount = pow(2, tessellations) + 1;
+	const float smallestWidth = size / ( float ) ( sideVerticesAmount - 1 );
+
+	// every vertex height and gradient sampled once, in a single batched call or one per tile
+	if (tessellations >= PARALLEL_CHUNK_TESSELLATIONS){
+		struct gridTilesJob job = {
+			xCoordsOffset, zCoordsOffset, smallestWidth,
+			sideVerticesAmount, pow(2, PARALLEL_TILE_TESSELLATIONS), pow(2, tessellations - PARALLEL_TILE_TESSELLATIONS),
+			heightGridFunction,
+			heightGrid, gradientGrid
+		};
+		run_parallel_for(sampleGridTile, &job, job.sideTilesAmount*job.sideTilesAmount);
+	}else{
+		heightGridFunction(xCoordsOffset, zCoordsOffset, smallestWidth, sideVerticesAmount, heightGrid, gradientGrid);
 	}
-
-	return count != 0 ? vec3fl_divide(normal, count) : normal;
 }
 
-Vec3fl getQuadNormal(float xCoordsOffset, float zCoordsOffset, int xQuadCoord, int zQuadCoord, float quadSideSize, float(*heightMapFunction)(float, float))
+int generateTessellatedQuad(
+	float xCoordsOffset,
+	float zCoordsOffset,
+	float** meshDestination, 
+	short** normalsDestination, 
+	unsigned int tessellations, 
+	float size, 
+	void(*heightGridFunction)(float, float, float, size_t, float*, float*),
+	size_t *verticesCount,
+	size_t *normalsCount
+)
 {
-	Vec3fl vertexNW = {
-		xQuadCoord * quadSideSize, 
-		0,
-		zQuadCoord * quadSideSize
-	};
-	Vec3fl vertexSW = {
-		xQuadCoord * quadSideSize, 
-		0,
-		( zQuadCoord + 1 ) * quadSideSize
-	};
-	Vec3fl vertexNE = {
-		( xQuadCoord + 1 ) * quadSideSize, 
-		0,
-		zQuadCoord * quadSideSize
-	};
+	const size_t sideVerticesAmount = pow(2, tessellations) + 1;
 
-	float heightNW = heightMapFunction( xCoordsOffset + vertexNW.x, zCoordsOffset + vertexNW.z );
-	float heightSW = heightMapFunction( xCoordsOffset + vertexSW.x, zCoordsOffset + vertexSW.z );
-	float heightNE = heightMapFunction( xCoordsOffset + vertexNE.x, zCoordsOffset + vertexNE.z );
+	float* heightGrid = malloc(sideVerticesAmount*sideVerticesAmount*sizeof(float));
+	float* gradientGrid = malloc(sideVerticesAmount*sideVerticesAmount*sizeof(float)*2);
+	sampleTessellatedQuadGrid(xCoordsOffset, zCoordsOffset, tessellations, size, heightGridFunction, heightGrid, gradientGrid);
 
-	vertexNW.y = heightNW; vertexSW.y = heightSW; vertexNE.y = heightNE;
+	int result = generateTessellatedQuadFromGrid(meshDestination, normalsDestination, tessellations, size, heightGrid, gradientGrid, verticesCount, normalsCount);
 
-	Vec3fl quadNormal = vec3fl_normalize(
-		vec3fl_cross(
-			vec3fl_difference( vertexSW, vertexNW ),
-			vec3fl_difference( vertexNE, vertexNW )
-		)
-	);
+	free(gradientGrid);
+	free(heightGrid);
 
-	return quadNormal;
+	return result;
 }
 
-// Terrain quads vertices order: first tri NW, SW, SE, second tri NW, SE, NE
-int generateTessellatedQuad(
-	float xCoordsOffset,
-	float zCoordsOffset,
+struct gridRowsJob {
+	size_t sideVerticesAmount;
+	const float *heightGrid, *gradientGrid;
+	float *mesh;
+	short *normals;
+};
+
+// vertex normals straight from the analytic gradient: n = normalize( -dh/dx, 1, -dh/dz )
+static void buildVerticesRow(void *data, size_t z)
+{
+	const struct gridRowsJob *job = data;
+	for (size_t x = 0; x < job->sideVerticesAmount; ++x){
+		size_t gridIndex = z*job->sideVerticesAmount + x;
+
+		*(job->mesh + gridIndex) = job->heightGrid[gridIndex];
+
+		Vec3fl normal = {-job->gradientGrid[2*gridIndex], 1, -job->gradientGrid[2*gridIndex + 1]};
+		encodeOctahedralNormal(vec3fl_normalize(normal), job->normals + gridIndex*2);
+	}
+}
+
+// Terrain meshes are (2^tessellations + 1)^2 vertices, row-major with x along rows, drawn with generateTessellatedQuadIndices.
+// Only heights are stored: the shader puts vertex i at x = ( i % side ) * spacing, z = ( i / side ) * spacing
+int generateTessellatedQuadFromGrid(
 	float** meshDestination, 
-	float** normalsDestination, 
+	short** normalsDestination, 
 	unsigned int tessellations, 
 	float size, 
-	float(*heightMapFunction)(float, float), 
+	const float* heightGrid,
+	const float* gradientGrid,
 	size_t *verticesCount,
 	size_t *normalsCount
 )
 {
-	const size_t sideQuadsAmount = pow(2, tessellations);
-	const float smallestWidth = size / ( float ) sideQuadsAmount;
-	const size_t totalQuadsAmount = pow(sideQuadsAmount, 2);
+	const size_t sideVerticesAmount = pow(2, tessellations) + 1;
 
-	const size_t vertices = totalQuadsAmount*6;
-	const size_t normals = totalQuadsAmount*6;
+	const size_t vertices = sideVerticesAmount*sideVerticesAmount;
+	const size_t normals = vertices;
 
-	*meshDestination = malloc(vertices*3*sizeof(float));
-	*normalsDestination = malloc(normals*3*sizeof(float));
+	*meshDestination = malloc(vertices*sizeof(float));
+	*normalsDestination = malloc(normals*2*sizeof(short));
 
 	*verticesCount = vertices;
 	*normalsCount = normals;
 
-	float* normalsPrecalculationBuffer = malloc(totalQuadsAmount*sizeof(float)*3);
+	struct gridRowsJob job = {
+		sideVerticesAmount,
+		heightGrid, gradientGrid,
+		*meshDestination, *normalsDestination
+	};
+
+	if (tessellations >= PARALLEL_CHUNK_TESSELLATIONS){
+		run_parallel_for(buildVerticesRow, &job, sideVerticesAmount);
+	}else{
+		for (size_t z = 0; z < sideVerticesAmount; ++z)
+			buildVerticesRow(&job, z);
+	}
 
-	for (size_t x = 0; x < sideQuadsAmount; ++x){
+	return 0;
+}
 
-		for (size_t z = 0; z < sideQuadsAmount; ++z){
-	
-			size_t quadIndex = z*sideQuadsAmount + x;
-			size_t index = quadIndex*6*3;
-			float quadPositionX = x*smallestWidth, quadPositionZ = z*smallestWidth;
-			
-			Vec2fl quadTopLeftPosition = {quadPositionX, quadPositionZ}, 
-				quadTopRightPosition = {quadPositionX+smallestWidth, quadPositionZ},
-				quadBottomLeftPosition = {quadPositionX, quadPositionZ+smallestWidth}, 
-				quadBottomRightPosition = {quadPositionX+smallestWidth, quadPositionZ+smallestWidth};
+// grid index of the t-th vertex along an edge (N, E, S, W), going towards +x or +z
+static size_t getEdgeVertexIndex(size_t sideVerticesAmount, size_t edge, size_t t)
+{
+	switch (edge){
+		case 0: return t;
+		case 1: return t*sideVerticesAmount + sideVerticesAmount - 1;
+		case 2: return (sideVerticesAmount - 1)*sideVerticesAmount + t;
+		default: return t*sideVerticesAmount;
+	}
+}
 
-			float quadTopLeftHeight = heightMapFunction(xCoordsOffset + quadTopLeftPosition.x, zCoordsOffset + quadTopLeftPosition.y),
-				quadTopRightHeight = heightMapFunction(xCoordsOffset + quadTopRightPosition.x, zCoordsOffset + quadTopRightPosition.y),
-				quadBottomLeftHeight = heightMapFunction(xCoordsOffset + quadBottomLeftPosition.x, zCoordsOffset + quadBottomLeftPosition.y),
-				quadBottomRightHeight = heightMapFunction(xCoordsOffset + quadBottomRightPosition.x, zCoordsOffset + quadBottomRightPosition.y);
+// Skirt vertices follow the grid, one edge (N, E, S, W) after the other: each copies its edge vertex's normal, skirtDepth lower
+int addTessellatedQuadSkirts(
+	float** meshDestination, 
+	short** normalsDestination, 
+	unsigned int tessellations, 
+	float skirtDepth,
+	size_t *verticesCount,
+	size_t *normalsCount
+)
+{
+	const size_t sideVerticesAmount = pow(2, tessellations) + 1;
+	const size_t gridVertices = sideVerticesAmount*sideVerticesAmount;
+	const size_t vertices = gridVertices + 4*sideVerticesAmount;
+
+	float* mesh = realloc(*meshDestination, vertices*sizeof(float));
+	short* normals = realloc(*normalsDestination, vertices*2*sizeof(short));
+
+	for (size_t edge = 0; edge < 4; ++edge){
+		for (size_t t = 0; t < sideVerticesAmount; ++t){
+			size_t skirtIndex = gridVertices + edge*sideVerticesAmount + t;
+			size_t edgeIndex = getEdgeVertexIndex(sideVerticesAmount, edge, t);
+
+			mesh[skirtIndex] = mesh[edgeIndex] - skirtDepth;
+			normals[skirtIndex*2] = normals[edgeIndex*2];
+			normals[skirtIndex*2 + 1] = normals[edgeIndex*2 + 1];
+		}
+	}
 
-			Vec3fl quadTopLeftPositionVec3fl = {quadTopLeftPosition.x, quadTopLeftHeight, quadTopLeftPosition.y},
-				quadBottomLeftPositionVec3fl = {quadBottomLeftPosition.x, quadBottomLeftHeight, quadBottomLeftPosition.y},
-				quadTopRightPositionVec3fl = {quadTopRightPosition.x, quadTopRightHeight, quadTopRightPosition.y};
+	*meshDestination = mesh;
+	*normalsDestination = normals;
+	*verticesCount = vertices;
+	*normalsCount = vertices;
 
-			Vec3fl quadNormal = vec3fl_normalize( 
-				vec3fl_cross(
-					vec3fl_difference( quadBottomLeftPositionVec3fl, quadTopLeftPositionVec3fl ),
-					vec3fl_difference( quadTopRightPositionVec3fl, quadTopLeftPositionVec3fl )
-				)
-			);
+	return 0;
+}
 
-			*(normalsPrecalculationBuffer + 3*quadIndex + 0) = quadNormal.x;
-			*(normalsPrecalculationBuffer + 3*quadIndex + 1) = quadNormal.y;
-			*(normalsPrecalculationBuffer + 3*quadIndex + 2) = quadNormal.z;
+// height at vertex ( x, z ) on the coarse grid's NW, SW, SE / NW, SE, NE triangles, its quads being ratio vertices wide
+static float getCoarseGridHeight(const float* coarseHeightGrid, size_t coarseSideVerticesAmount, size_t ratio, size_t x, size_t z)
+{
+	size_t westX = x / ratio, northZ = z / ratio;
+	if (westX == coarseSideVerticesAmount - 1) --westX;
+	if (northZ == coarseSideVerticesAmount - 1) --northZ;
+	float fx = (float)(x - westX*ratio) / ratio, fz = (float)(z - northZ*ratio) / ratio;
+
+	const float* row = coarseHeightGrid + northZ*coarseSideVerticesAmount + westX;
+	float northWest = row[0], northEast = row[1], southWest = row[coarseSideVerticesAmount], southEast = row[coarseSideVerticesAmount + 1];
+	return fz >= fx ? northWest + fz*(southWest - northWest) + fx*(southEast - southWest) : northWest + fx*(northEast - northWest) + fz*(southEast - northEast);
+}
 
-			*((*meshDestination) + index + 0) = quadTopLeftPosition.x;
-			*((*meshDestination) + index + 1) = quadTopLeftHeight;
-			*((*meshDestination) + index + 2) = quadTopLeftPosition.y;
+// Morph heights follow the mesh's heights in the same buffer: what each vertex's height becomes once fully morphed
+int addTessellatedQuadMorphHeights(
+	float** meshDestination, 
+	unsigned int tessellations, 
+	unsigned int coarseTessellations, 
+	const float* coarseHeightGrid,
+	size_t verticesCount
+)
+{
+	const size_t sideVerticesAmount = pow(2, tessellations) + 1;
+	const size_t coarseSideVerticesAmount = pow(2, coarseTessellations) + 1;
+	const size_t ratio = (sideVerticesAmount - 1) / (coarseSideVerticesAmount - 1);
+	float* mesh = realloc(*meshDestination, verticesCount*2*sizeof(float));
+	float* coarseHeights = mesh + verticesCount;
+
+	// without the parent's own samples, its vertices are taken at the chunk's heights
+	float* ownCoarseHeightGrid = NULL;
+	if (coarseHeightGrid == NULL){
+		ownCoarseHeightGrid = malloc(coarseSideVerticesAmount*coarseSideVerticesAmount*sizeof(float));
+		for (size_t z = 0; z < coarseSideVerticesAmount; ++z)
+			for (size_t x = 0; x < coarseSideVerticesAmount; ++x)
+				ownCoarseHeightGrid[z*coarseSideVerticesAmount + x] = mesh[z*ratio*sideVerticesAmount + x*ratio];
+		coarseHeightGrid = ownCoarseHeightGrid;
+	}
 
-			*((*meshDestination) + index + 3) = quadBottomLeftPosition.x;
-			*((*meshDestination) + index + 4) = quadBottomLeftHeight;
-			*((*meshDestination) + index + 5) = quadBottomLeftPosition.y;
+	for (size_t z = 0; z < sideVerticesAmount; ++z)
+		for (size_t x = 0; x < sideVerticesAmount; ++x)
+			coarseHeights[z*sideVerticesAmount + x] = getCoarseGridHeight(coarseHeightGrid, coarseSideVerticesAmount, ratio, x, z);
 
-			*((*meshDestination) + index + 6) = quadBottomRightPosition.x;
-			*((*meshDestination) + index + 7) = quadBottomRightHeight;
-			*((*meshDestination) + index + 8) = quadBottomRightPosition.y;
+	// skirts keep their depth below the morphing edge
+	for (size_t i = sideVerticesAmount*sideVerticesAmount; i < verticesCount; ++i){
+		size_t edge = (i - sideVerticesAmount*sideVerticesAmount) / sideVerticesAmount;
+		size_t edgeIndex = getEdgeVertexIndex(sideVerticesAmount, edge, (i - sideVerticesAmount*sideVerticesAmount) % sideVerticesAmount);
+		coarseHeights[i] = mesh[i] + coarseHeights[edgeIndex] - mesh[edgeIndex];
+	}
 
+	free(ownCoarseHeightGrid);
+	*meshDestination = mesh;
 
-			*((*meshDestination) + index + 9) = quadTopLeftPosition.x;
-			*((*meshDestination) + index + 10) = quadTopLeftHeight;
-			*((*meshDestination) + index + 11) = quadTopLeftPosition.y;
+	return 0;
+}
 
-			*((*meshDestination) + index + 12) = quadBottomRightPosition.x;
-			*((*meshDestination) + index + 13) = quadBottomRightHeight;
-			*((*meshDestination) + index + 14) = quadBottomRightPosition.y;
+void encodeOctahedralNormal(Vec3fl normal, short* destination)
+{
+	float norm = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	float u = normal.x / norm, v = normal.z / norm;
+
+	if (normal.y < 0){
+		float foldedU = (1 - fabsf(v)) * (u < 0 ? -1 : 1);
+		float foldedV = (1 - fabsf(u)) * (v < 0 ? -1 : 1);
+		u = foldedU;
+		v = foldedV;
+	}
 
-			*((*meshDestination) + index + 15) = quadTopRightPosition.x;
-			*((*meshDestination) + index + 16) = quadTopRightHeight;
-			*((*meshDestination) + index + 17) = quadTopRightPosition.y;
+	destination[0] = lroundf(fminf(fmaxf(u, -1), 1) * 32767);
+	destination[1] = lroundf(fminf(fmaxf(v, -1), 1) * 32767);
+}
 
+// Skirt quads come after the surface, facing outwards: edge, skirt, next skirt then edge, next skirt, next edge, reversed on N and E
+static void writeSkirtIndices(unsigned int* indices, size_t sideQuadsAmount)
+{
+	const size_t sideVerticesAmount = sideQuadsAmount + 1;
+
+	for (size_t edge = 0; edge < 4; ++edge){
+		boolval reversed = edge < 2;
+		for (size_t t = 0; t < sideQuadsAmount; ++t){
+			size_t index = (edge*sideQuadsAmount + t)*6;
+			unsigned int edgeVertex = getEdgeVertexIndex(sideVerticesAmount, edge, t),
+				nextEdgeVertex = getEdgeVertexIndex(sideVerticesAmount, edge, t + 1),
+				skirtVertex = sideVerticesAmount*sideVerticesAmount + edge*sideVerticesAmount + t,
+				nextSkirtVertex = skirtVertex + 1;
+
+			indices[index + 0] = edgeVertex;
+			indices[index + 1] = reversed ? nextSkirtVertex : skirtVertex;
+			indices[index + 2] = reversed ? skirtVertex : nextSkirtVertex;
+
+			indices[index + 3] = edgeVertex;
+			indices[index + 4] = reversed ? nextEdgeVertex : nextSkirtVertex;
+			indices[index + 5] = reversed ? nextSkirtVertex : nextEdgeVertex;
 		}
+	}
+}
+
+// Terrain quads vertices order: first tri NW, SW, SE, second tri NW, SE, NE
+unsigned int* generateTessellatedQuadIndices(unsigned int tessellations, boolval skirts, size_t *indicesCount)
+{
+	const size_t sideQuadsAmount = pow(2, tessellations);
+	const size_t sideVerticesAmount = sideQuadsAmount + 1;
+	const size_t gridIndicesCount = sideQuadsAmount*sideQuadsAmount*6;
+
+	*indicesCount = gridIndicesCount + (skirts ? 4*sideQuadsAmount*6 : 0);
+	unsigned int* indices = malloc(*indicesCount*sizeof(unsigned int));
+
+	for (size_t z = 0; z < sideQuadsAmount; ++z){
+		for (size_t x = 0; x < sideQuadsAmount; ++x){
+			size_t index = (z*sideQuadsAmount + x)*6;
+			unsigned int northWest = z*sideVerticesAmount + x, northEast = northWest + 1,
+				southWest = northWest + sideVerticesAmount, southEast = southWest + 1;
 
+			indices[index + 0] = northWest;
+			indices[index + 1] = southWest;
+			indices[index + 2] = southEast;
+
+			indices[index + 3] = northWest;
+			indices[index + 4] = southEast;
+			indices[index + 5] = northEast;
+		}
 	}
 
-	for (size_t x = 0; x < sideQuadsAmount; ++x){
-
-		for (size_t z = 0; z < sideQuadsAmount; ++z){
-
-			size_t quadIndex = z*sideQuadsAmount + x;
-
-			Vec3fl computedQuadNeighborNormalsNW, computedQuadNeighborNormalsN, computedQuadNeighborNormalsNE,
-				computedQuadNeighborNormalsW, computedQuadNeighborNormalsE, 
-				computedQuadNeighborNormalsSW, computedQuadNeighborNormalsS, computedQuadNeighborNormalsSE; 
-				  
-
-			if ( !( x > 0 && z > 0 ) )
-				computedQuadNeighborNormalsNW = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x-1,
-					z-1,
-					smallestWidth, heightMapFunction
-				);
-			if ( !( z > 0 ) )
-				computedQuadNeighborNormalsN = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x,
-					z-1,
-					smallestWidth, heightMapFunction
-				);
-			if ( !( x < (sideQuadsAmount - 1) && z > 0 ) )
-				computedQuadNeighborNormalsNE = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x+1,
-					z-1,
-					smallestWidth, heightMapFunction
-				);
-
-			if ( !( x > 0 ) )
-				computedQuadNeighborNormalsW = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x-1,
-					z,
-					smallestWidth, heightMapFunction
-				);
-			if ( !( x < (sideQuadsAmount - 1) ) )
-				computedQuadNeighborNormalsE = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x+1,
-					z,
-					smallestWidth, heightMapFunction
-				);
-
-			if ( !( x > 0 && z < (sideQuadsAmount - 1) ) )
-				computedQuadNeighborNormalsSW = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x-1,
-					z+1,
-					smallestWidth, heightMapFunction
-				);
-			if ( !( z < (sideQuadsAmount - 1) ) )
-				computedQuadNeighborNormalsS = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x,
-					z+1,
-					smallestWidth, heightMapFunction
-				);
-			if ( !( x < (sideQuadsAmount-1) && z < (sideQuadsAmount-1) ) )
-				computedQuadNeighborNormalsSE = getQuadNormal( 
-					xCoordsOffset, 
-					zCoordsOffset, 
-					x+1,
-					z+1,
-					smallestWidth, heightMapFunction
-				);
-
-			Vec3fl  *quadNeighborNormalsNW = (x > 0 && z > 0) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex - sideQuadsAmount - 1) : 
-					&computedQuadNeighborNormalsNW,
-				*quadNeighborNormalsN = (z > 0) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex - sideQuadsAmount) : 
-					&computedQuadNeighborNormalsN,
-				*quadNeighborNormalsNE = (x < (sideQuadsAmount - 1) && z > 0) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex - sideQuadsAmount + 1) : 
-					&computedQuadNeighborNormalsNE,
-
-				*quadNeighborNormalsW = (x > 0) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex - 1) : 
-					&computedQuadNeighborNormalsW,
-				*quadNormals = (Vec3fl*)normalsPrecalculationBuffer + quadIndex,
-				*quadNeighborNormalsE = (x < (sideQuadsAmount - 1)) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex + 1) : 
-					&computedQuadNeighborNormalsE,
-
-				*quadNeighborNormalsSW = (x > 0 && z < (sideQuadsAmount - 1)) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex + sideQuadsAmount - 1) : 
-					&computedQuadNeighborNormalsSW,
-				*quadNeighborNormalsS = (z < (sideQuadsAmount - 1)) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex + sideQuadsAmount) : 
-					&computedQuadNeighborNormalsS,
-				*quadNeighborNormalsSE = (x < (sideQuadsAmount - 1) && z < (sideQuadsAmount - 1)) ? ((Vec3fl*)normalsPrecalculationBuffer + quadIndex + sideQuadsAmount + 1) : 
-					&computedQuadNeighborNormalsSE;
-
-
-			Vec3fl verticeNWNormal = neighborNormalsAverage(
-				quadNeighborNormalsNW,
-				quadNeighborNormalsN,
-				quadNeighborNormalsW,
-				quadNormals
-			);
-
-			Vec3fl verticeNENormal = neighborNormalsAverage(
-				quadNeighborNormalsNE,
-				quadNeighborNormalsN,
-				quadNeighborNormalsE,
-				quadNormals
-			);
-
-			Vec3fl verticeSWNormal = neighborNormalsAverage(
-				quadNeighborNormalsSW,
-				quadNeighborNormalsS,
-				quadNeighborNormalsW,
-				quadNormals
-			);
-
-			Vec3fl verticeSENormal = neighborNormalsAverage(
-				quadNeighborNormalsSE,
-				quadNeighborNormalsS,
-				quadNeighborNormalsE,
-				quadNormals
-			);
-
-			//NW, SW, SE, NW, SE, NE
-						
-			*((Vec3fl*)(*normalsDestination) + quadIndex*6 + 0) = verticeNWNormal;
-			*((Vec3fl*)(*normalsDestination) + quadIndex*6 + 1) = verticeSWNormal;
-			*((Vec3fl*)(*normalsDestination) + quadIndex*6 + 2) = verticeSENormal;
-			*((Vec3fl*)(*normalsDestination) + quadIndex*6 + 3) = verticeNWNormal;
-			*((Vec3fl*)(*normalsDestination) + quadIndex*6 + 4) = verticeSENormal;
-			*((Vec3fl*)(*normalsDestination) + quadIndex*6 + 5) = verticeNENormal;
+	if (skirts)
+		writeSkirtIndices(indices + gridIndicesCount, sideQuadsAmount);
+
+	return indices;
+}
 
+static int compareFloats(const void* a, const void* b)
+{
+	const float fa = *(const float*)a, fb = *(const float*)b;
+	return fa < fb ? -1 : fa > fb;
+}
+
+float getTessellatedQuadRoughness(const float* heights, unsigned int tessellations, float size)
+{
+	const size_t sideVerticesAmount = pow(2, tessellations) + 1;
+	const float spacing = size / (sideVerticesAmount - 1);
+	if (sideVerticesAmount < 3)
+		return 0;
+
+	float* bends = malloc(sizeof(float) * 2 * (sideVerticesAmount - 2) * (sideVerticesAmount - 2));
+	size_t count = 0;
+	for (size_t z = 1; z + 1 < sideVerticesAmount; ++z){
+		for (size_t x = 1; x + 1 < sideVerticesAmount; ++x){
+			const float* h = heights + z*sideVerticesAmount + x;
+			bends[count++] = fabsf(h[-1] - 2*h[0] + h[1]) / spacing;
+			bends[count++] = fabsf(h[-(long)sideVerticesAmount] - 2*h[0] + h[sideVerticesAmount]) / spacing;
 		}
+	}
 
+	qsort(bends, count, sizeof(float), compareFloats);
+	const float roughness = bends[(size_t)(count * TESSELLATION_ROUGHNESS_PERCENTILE)];
+	free(bends);
+	return roughness;
+}
+
+void getTessellatedQuadHeightBounds(const float* heights, unsigned int tessellations, float* minHeight, float* maxHeight)
+{
+	const size_t verticesAmount = (pow(2, tessellations) + 1) * (pow(2, tessellations) + 1);
+	*minHeight = heights[0];
+	*maxHeight = heights[0];
+	for (size_t i = 1; i < verticesAmount; ++i){
+		if (heights[i] < *minHeight) *minHeight = heights[i];
+		if (heights[i] > *maxHeight) *maxHeight = heights[i];
 	}
+}
+
+float getTessellationMaxError(size_t level)
+{
+	return level >= TESSELLATION_DETAIL_LEVEL ? TESSELLATION_MAX_ERROR : ldexpf(TESSELLATION_MAX_ERROR, TESSELLATION_DETAIL_LEVEL - level);
+}
 
-	free(normalsPrecalculationBuffer);
+unsigned int getTessellationsForRoughness(float roughness, size_t level)
+{
+	if (roughness <= 0)
+		return MIN_TESSELLATIONS;
 
-	return 0;
+	// size / spacing quads, the spacing being 8 * max error * size / roughness
+	int tessellations = ceilf(log2f(roughness / (8*getTessellationMaxError(level))));
+	return tessellations < MIN_TESSELLATIONS ? MIN_TESSELLATIONS : tessellations > MAX_TESSELLATIONS ? MAX_TESSELLATIONS : tessellations;
+}
+
+/// adaptive meshes
+
+// Right triangulated irregular networks: the chunk's square splits into the NE and SW halves along its NW - SE diagonal,
+// and every triangle splits in two at the middle of its hypotenuse, down to half quads. Triangle ids follow that
+// binary tree: 2 and 3 are the halves, the children of id are 2 * id and 2 * id + 1.
+
+// corners of a triangle in grid coordinates: a and b are the hypotenuse, c the right angle
+static void getAdaptiveTriangle(size_t id, int sideQuadsAmount, int* ax, int* az, int* bx, int* bz, int* cx, int* cz)
+{
+	// the bit under the leading one picks the half, the ones below it the path down from there
+	int depth = 0;
+	while ((id >> (depth + 1)) > 1) ++depth;
+
+	if ((id >> depth) & 1){
+		*ax = 0; *az = 0; *bx = sideQuadsAmount; *bz = sideQuadsAmount; *cx = sideQuadsAmount; *cz = 0;
+	}else{
+		*ax = sideQuadsAmount; *az = sideQuadsAmount; *bx = 0; *bz = 0; *cx = 0; *cz = sideQuadsAmount;
+	}
+	for (int bit = depth - 1; bit >= 0; --bit){
+		int mx = (*ax + *bx) / 2, mz = (*az + *bz) / 2;
+		if ((id >> bit) & 1){
+			*bx = *ax; *bz = *az; *ax = *cx; *az = *cz;
+		}else{
+			*ax = *bx; *az = *bz; *bx = *cx; *bz = *cz;
+		}
+		*cx = mx; *cz = mz;
+	}
+}
+
+// largest distance between the grid heights under a triangle and the triangle's plane
+static float getAdaptiveTriangleError(const float* heights, size_t sideVerticesAmount, int ax, int az, int bx, int bz, int cx, int cz)
+{
+	const float ha = heights[az*sideVerticesAmount + ax], hb = heights[bz*sideVerticesAmount + bx], hc = heights[cz*sideVerticesAmount + cx];
+	const int doubledArea = (bx - ax)*(cz - az) - (bz - az)*(cx - ax);
+	const int minX = ax < bx ? (ax < cx ? ax : cx) : (bx < cx ? bx : cx), maxX = ax > bx ? (ax > cx ? ax : cx) : (bx > cx ? bx : cx);
+	const int minZ = az < bz ? (az < cz ? az : cz) : (bz < cz ? bz : cz), maxZ = az > bz ? (az > cz ? az : cz) : (bz > cz ? bz : cz);
+	float error = 0;
+
+	for (int z = minZ; z <= maxZ; ++z){
+		for (int x = minX; x <= maxX; ++x){
+			// barycentric weights times the doubled area, all of its sign inside
+			int wa = (bx - x)*(cz - z) - (bz - z)*(cx - x), wb = (cx - x)*(az - z) - (cz - z)*(ax - x), wc = doubledArea - wa - wb;
+			if (doubledArea < 0){
+				wa = -wa; wb = -wb; wc = -wc;
+			}
+			if (wa < 0 || wb < 0 || wc < 0) continue;
+
+			float planeHeight = ((float)wa*ha + (float)wb*hb + (float)wc*hc) / abs(doubledArea);
+			error = fmaxf(error, fabsf(planeHeight - heights[z*sideVerticesAmount + x]));
+		}
+	}
+
+	return error;
+}
+
+float* computeTessellatedQuadErrors(const float* heights, unsigned int tessellations)
+{
+	const int sideQuadsAmount = pow(2, tessellations);
+	const size_t sideVerticesAmount = sideQuadsAmount + 1;
+	const size_t trianglesAmount = (size_t)sideQuadsAmount*sideQuadsAmount*2 - 2;
+	const size_t parentTrianglesAmount = trianglesAmount - (size_t)sideQuadsAmount*sideQuadsAmount;
+
+	float* errors = calloc(sideVerticesAmount*sideVerticesAmount, sizeof(float));
+
+	// children before parents: a hypotenuse middle's error covers the triangles on both sides of the hypotenuse and all
+	// the ones below them, so that leaving it out bounds the error of every vertex under the unsplit triangle
+	for (size_t i = trianglesAmount; i-- > 0;){
+		int ax, az, bx, bz, cx, cz;
+		getAdaptiveTriangle(i + 2, sideQuadsAmount, &ax, &az, &bx, &bz, &cx, &cz);
+		int mx = (ax + bx) / 2, mz = (az + bz) / 2;
+
+		size_t middle = mz*sideVerticesAmount + mx;
+		errors[middle] = fmaxf(errors[middle], getAdaptiveTriangleError(heights, sideVerticesAmount, ax, az, bx, bz, cx, cz));
+
+		if (i < parentTrianglesAmount){
+			size_t leftChild = ((az + cz) / 2)*sideVerticesAmount + (ax + cx) / 2;
+			size_t rightChild = ((bz + cz) / 2)*sideVerticesAmount + (bx + cx) / 2;
+			errors[middle] = fmaxf(errors[middle], fmaxf(errors[leftChild], errors[rightChild]));
+		}
+	}
+
+	return errors;
+}
+
+struct adaptiveMesh {
+	const float* errors;
+	size_t sideVerticesAmount;
+	float maxError;
+	unsigned int* indices;
+	size_t indicesCount;
+};
+
+// splits a triangle while the middle of its hypotenuse is off by more than the allowed error, writes the leaves
+// counterclockwise seen from above, like the uniform mesh's
+static void addAdaptiveTriangle(struct adaptiveMesh* mesh, int ax, int az, int bx, int bz, int cx, int cz)
+{
+	int mx = (ax + bx) / 2, mz = (az + bz) / 2;
+
+	if (abs(ax - cx) + abs(az - cz) > 1 && mesh->errors[mz*mesh->sideVerticesAmount + mx] > mesh->maxError){
+		addAdaptiveTriangle(mesh, cx, cz, ax, az, mx, mz);
+		addAdaptiveTriangle(mesh, bx, bz, cx, cz, mx, mz);
+		return;
+	}
+
+	if (mesh->indices != NULL){
+		mesh->indices[mesh->indicesCount + 0] = az*mesh->sideVerticesAmount + ax;
+		mesh->indices[mesh->indicesCount + 1] = bz*mesh->sideVerticesAmount + bx;
+		mesh->indices[mesh->indicesCount + 2] = cz*mesh->sideVerticesAmount + cx;
+	}
+	mesh->indicesCount += 3;
+}
+
+static void addAdaptiveTriangles(struct adaptiveMesh* mesh, int sideQuadsAmount)
+{
+	addAdaptiveTriangle(mesh, 0, 0, sideQuadsAmount, sideQuadsAmount, sideQuadsAmount, 0);
+	addAdaptiveTriangle(mesh, sideQuadsAmount, sideQuadsAmount, 0, 0, 0, sideQuadsAmount);
+}
+
+unsigned int* generateTessellatedQuadAdaptiveIndices(const float* errors, unsigned int tessellations, float maxError, boolval skirts, size_t *indicesCount)
+{
+	const int sideQuadsAmount = pow(2, tessellations);
+	struct adaptiveMesh mesh = { errors, sideQuadsAmount + 1, maxError, NULL, 0 };
+
+	// counted first, then written
+	addAdaptiveTriangles(&mesh, sideQuadsAmount);
+	size_t surfaceIndicesCount = mesh.indicesCount;
+
+	*indicesCount = surfaceIndicesCount + (skirts ? 4*sideQuadsAmount*6 : 0);
+	mesh.indices = malloc(*indicesCount*sizeof(unsigned int));
+	mesh.indicesCount = 0;
+	addAdaptiveTriangles(&mesh, sideQuadsAmount);
+
+	if (skirts)
+		writeSkirtIndices(mesh.indices + surfaceIndicesCount, sideQuadsAmount);
+
+	return mesh.indices;
+}
+
+/// vertex cache order
+
+// Forsyth's linear-speed vertex cache optimisation: triangles are emitted greedily, each time the best scored one among
+// those using the vertices last emitted. A vertex scores higher the more recently it was used (the last triangle's
+// three alike, so that strips don't just flip back and forth) and the fewer triangles it has left, so that vertices
+// get finished and leave the cache rather than stay forever.
+#define VERTEX_CACHE_SCORED_ENTRIES 32
+#define VERTEX_CACHE_DECAY_POWER 1.5f
+#define VERTEX_CACHE_LAST_TRIANGLE_SCORE 0.75f
+#define VERTEX_CACHE_VALENCE_BOOST_SCALE 2.0f
+#define VERTEX_CACHE_VALENCE_BOOST_POWER 0.5f
+
+static float getVertexCacheScore(int cachePosition, unsigned int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+		return -1;
+
+	float score = 0;
+	if (cachePosition >= 3)
+		score = powf(1.0f - (float)(cachePosition - 3) / (VERTEX_CACHE_SCORED_ENTRIES - 3), VERTEX_CACHE_DECAY_POWER);
+	else if (cachePosition >= 0)
+		score = VERTEX_CACHE_LAST_TRIANGLE_SCORE;
+
+	return score + VERTEX_CACHE_VALENCE_BOOST_SCALE*powf(remainingTriangles, -VERTEX_CACHE_VALENCE_BOOST_POWER);
+}
+
+void optimizeVertexCacheOrder(unsigned int* indices, size_t indicesCount)
+{
+	const size_t trianglesAmount = indicesCount / 3;
+	size_t verticesAmount = 0;
+	for (size_t i = 0; i < indicesCount; ++i)
+		if (indices[i] >= verticesAmount) verticesAmount = indices[i] + 1;
+
+	// each vertex's triangles, in one array, the ones still to emit first
+	unsigned int* remainingTriangles = calloc(verticesAmount, sizeof(unsigned int));
+	size_t* firstTriangle = malloc((verticesAmount + 1)*sizeof(size_t));
+	size_t* vertexTriangles = malloc(indicesCount*sizeof(size_t));
+	for (size_t i = 0; i < indicesCount; ++i)
+		++remainingTriangles[indices[i]];
+	firstTriangle[0] = 0;
+	for (size_t v = 0; v < verticesAmount; ++v)
+		firstTriangle[v + 1] = firstTriangle[v] + remainingTriangles[v];
+	for (size_t v = 0; v < verticesAmount; ++v)
+		remainingTriangles[v] = 0;
+	for (size_t i = 0; i < indicesCount; ++i){
+		unsigned int v = indices[i];
+		vertexTriangles[firstTriangle[v] + remainingTriangles[v]++] = i / 3;
+	}
+
+	int* cachePositions = malloc(verticesAmount*sizeof(int));
+	float* vertexScores = malloc(verticesAmount*sizeof(float));
+	for (size_t v = 0; v < verticesAmount; ++v){
+		cachePositions[v] = -1;
+		vertexScores[v] = getVertexCacheScore(-1, remainingTriangles[v]);
+	}
+
+	float* triangleScores = malloc(trianglesAmount*sizeof(float));
+	boolval* emitted = calloc(trianglesAmount, sizeof(boolval));
+	for (size_t t = 0; t < trianglesAmount; ++t)
+		triangleScores[t] = vertexScores[indices[t*3]] + vertexScores[indices[t*3 + 1]] + vertexScores[indices[t*3 + 2]];
+
+	unsigned int* ordered = malloc(indicesCount*sizeof(unsigned int));
+	// three more entries than scored, for the vertices pushed out by the last triangle
+	unsigned int cache[VERTEX_CACHE_SCORED_ENTRIES + 3], newCache[VERTEX_CACHE_SCORED_ENTRIES + 3];
+	size_t cacheSize = 0, nextUnemitted = 0;
+
+	for (size_t emittedAmount = 0; emittedAmount < trianglesAmount; ++emittedAmount){
+		// the best triangle around the cache, or the next one in the input order when the cache has none left
+		size_t best = trianglesAmount;
+		float bestScore = -1;
+		for (size_t c = 0; c < cacheSize; ++c){
+			unsigned int v = cache[c];
+			for (size_t i = firstTriangle[v]; i < firstTriangle[v] + remainingTriangles[v]; ++i){
+				size_t t = vertexTriangles[i];
+				if (triangleScores[t] > bestScore){
+					best = t;
+					bestScore = triangleScores[t];
+				}
+			}
+		}
+		if (best == trianglesAmount){
+			while (emitted[nextUnemitted]) ++nextUnemitted;
+			best = nextUnemitted;
+		}
+
+		emitted[best] = true;
+		size_t newCacheSize = 0;
+		for (size_t k = 0; k < 3; ++k){
+			unsigned int v = indices[best*3 + k];
+			ordered[emittedAmount*3 + k] = v;
+			newCache[newCacheSize++] = v;
+
+			// the triangle leaves the vertex's list
+			for (size_t i = firstTriangle[v]; i < firstTriangle[v] + remainingTriangles[v]; ++i){
+				if (vertexTriangles[i] == best){
+					vertexTriangles[i] = vertexTriangles[firstTriangle[v] + remainingTriangles[v] - 1];
+					vertexTriangles[firstTriangle[v] + remainingTriangles[v] - 1] = best;
+					break;
+				}
+			}
+			--remainingTriangles[v];
+		}
+
+		// the triangle's vertices move to the front, the others shift back, and the ones past the end drop out
+		for (size_t c = 0; c < cacheSize; ++c){
+			unsigned int v = cache[c];
+			if (v == newCache[0] || v == newCache[1] || v == newCache[2]) continue;
+			if (newCacheSize < VERTEX_CACHE_SCORED_ENTRIES + 3) newCache[newCacheSize++] = v;
+		}
+		for (size_t c = 0; c < cacheSize; ++c)
+			cachePositions[cache[c]] = -1;
+		for (size_t c = 0; c < newCacheSize; ++c){
+			cache[c] = newCache[c];
+			cachePositions[cache[c]] = c < VERTEX_CACHE_SCORED_ENTRIES ? (int)c : -1;
+		}
+		cacheSize = newCacheSize;
+
+		// rescoring the cached vertices, and the triangles they still have
+		for (size_t c = 0; c < cacheSize; ++c){
+			unsigned int v = cache[c];
+			vertexScores[v] = getVertexCacheScore(cachePositions[v], remainingTriangles[v]);
+		}
+		for (size_t c = 0; c < cacheSize; ++c){
+			unsigned int v = cache[c];
+			for (size_t i = firstTriangle[v]; i < firstTriangle[v] + remainingTriangles[v]; ++i){
+				size_t t = vertexTriangles[i];
+				triangleScores[t] = vertexScores[indices[t*3]] + vertexScores[indices[t*3 + 1]] + vertexScores[indices[t*3 + 2]];
+			}
+		}
+		if (cacheSize > VERTEX_CACHE_SCORED_ENTRIES) cacheSize = VERTEX_CACHE_SCORED_ENTRIES;
+	}
+
+	for (size_t i = 0; i < indicesCount; ++i)
+		indices[i] = ordered[i];
+
+	free(ordered);
+	free(emitted);
+	free(triangleScores);
+	free(vertexScores);
+	free(cachePositions);
+	free(vertexTriangles);
+	free(firstTriangle);
+	free(remainingTriangles);
 }
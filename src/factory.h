@@ -5,20 +5,102 @@
 
 #include "utils.h"
 
-Vec3fl neighborNormalsAverage(Vec3fl *a, Vec3fl *b, Vec3fl *c, Vec3fl *d);
-
-Vec3fl getQuadNormal(float xCoordsOffset, float zCoordsOffset, int xQuadCoord, int zQuadCoord, float quadSideSize, float(*heightMapFunction)(float, float));
-
+// chunk meshes: one height and one octahedral normal (two snorm16, see encodeOctahedralNormal) per grid vertex
 int generateTessellatedQuad(
 	float xCoordsOffset,
 	float zCoordsOffset,
 	float** meshDestination, 
-	float** normalsDestination, 
+	short** normalsDestination, 
 	unsigned int tessellations, 
 	float size, 
-	float(*heightMapFunction)(float, float),
+	void(*heightGridFunction)(float, float, float, size_t, float*, float*),
+	size_t *verticesCount, 
+	size_t *normalsCount
+);
+
+// the heights and interleaved gradients generateTessellatedQuad samples, over (2^tessellations + 1)^2 vertices
+void sampleTessellatedQuadGrid(
+	float xCoordsOffset,
+	float zCoordsOffset,
+	unsigned int tessellations, 
+	float size, 
+	void(*heightGridFunction)(float, float, float, size_t, float*, float*),
+	float* heightGrid,
+	float* gradientGrid
+);
+
+// same mesh from heights and interleaved gradients already sampled over its (2^tessellations + 1)^2 vertices
+int generateTessellatedQuadFromGrid(
+	float** meshDestination, 
+	short** normalsDestination, 
+	unsigned int tessellations, 
+	float size, 
+	const float* heightGrid,
+	const float* gradientGrid,
+	size_t *verticesCount, 
+	size_t *normalsCount
+);
+
+// folds a unit normal onto the octahedron |x| + |y| + |z| = 1, upper half (y >= 0) flattened on the xz plane and lower
+// half unfolded onto the corners, and stores its ( x, z ) as two snorm16; texturedTerrain.vert decodes it
+void encodeOctahedralNormal(Vec3fl normal, short* destination);
+
+// appends a border strip hanging skirtDepth below each edge, hiding the cracks between chunks of different levels
+int addTessellatedQuadSkirts(
+	float** meshDestination, 
+	short** normalsDestination, 
+	unsigned int tessellations, 
+	float skirtDepth,
 	size_t *verticesCount, 
 	size_t *normalsCount
 );
 
+// appends, after the verticesCount heights, the height each vertex has on its parent's coarser triangles, for geomorphing.
+// coarseHeightGrid holds the parent's heights over the chunk, (2^coarseTessellations + 1)^2 samples, coarseTessellations
+// being below tessellations (one less for a parent of the same tessellation); NULL reuses the chunk's own heights there,
+// which leaves the detail only the chunk resolves to pop
+int addTessellatedQuadMorphHeights(
+	float** meshDestination, 
+	unsigned int tessellations, 
+	unsigned int coarseTessellations, 
+	const float* coarseHeightGrid,
+	size_t verticesCount
+);
+
+// triangle list over the vertex grid of any chunk of that tessellation, and its skirts, to share in one index buffer
+unsigned int* generateTessellatedQuadIndices(unsigned int tessellations, boolval skirts, size_t *indicesCount);
+
+// how much the slope changes across the grid's inner vertices along x and z, |second difference| / spacing, at
+// TESSELLATION_ROUGHNESS_PERCENTILE of them. The terrain's ridges and creases keep it the same at any sampling,
+// where a curvature would grow with it; the highest values, past the percentile, are the cliffs of the value
+// noise lattice, that no resolution smooths out
+float getTessellatedQuadRoughness(const float* heights, unsigned int tessellations, float size);
+
+// lowest and highest of the grid's (2^tessellations + 1)^2 heights
+void getTessellatedQuadHeightBounds(const float* heights, unsigned int tessellations, float* minHeight, float* maxHeight);
+
+// the height error allowed to a chunk of the level, relative to its size: TESSELLATION_MAX_ERROR from
+// TESSELLATION_DETAIL_LEVEL down, doubling for each level above it. The quadtree splits chunks at a distance
+// proportional to their size, so a size-relative error is the same on screen at every level; the coarse levels only
+// cover the distance, near the horizon, and get the looser bound there
+float getTessellationMaxError(size_t level);
+
+// the fewest quads for which interpolating over that much slope change, h / 8 times it on average between vertices h
+// apart, stays under the level's max error, within MIN_TESSELLATIONS and MAX_TESSELLATIONS: flat ground and distant
+// levels get coarse chunks, rough ground near the camera fine ones
+unsigned int getTessellationsForRoughness(float roughness, size_t level);
+
+// per grid vertex, the largest height error of the adaptive meshes that leave it out (0 at the corners), for
+// generateTessellatedQuadAdaptiveIndices; heights are the chunk's (2^tessellations + 1)^2 grid heights
+float* computeTessellatedQuadErrors(const float* heights, unsigned int tessellations);
+
+// triangle list over the same vertices, refined until no surface point is off by more than maxError (0 gives the full
+// grid): a right triangulated irregular network, crack free inside the chunk. Neighbours refine their shared edge on
+// their own errors, the skirts hide the difference. Skirts are appended like the uniform list's
+unsigned int* generateTessellatedQuadAdaptiveIndices(const float* errors, unsigned int tessellations, float maxError, boolval skirts, size_t *indicesCount);
+
+// reorders a triangle list's triangles for the post-transform vertex cache, so that fewer vertices get shaded more than
+// once; the triangles and their winding stay the same
+void optimizeVertexCacheOrder(unsigned int* indices, size_t indicesCount);
+
 #endif
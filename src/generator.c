@@ -8,21 +8,34 @@
 #include "quadtree.h"
 #include "mempools.h"
 #include "vbopools.h"
+#include "heightcache.h"
+#include "parallel.h"
+#include "priorityqueue.h"
+#include "mpscring.h"
 #include "config.h"
 #include "debug.h"
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
 #include <pthread.h>
+#include <stdatomic.h>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <cglm/cglm.h>
+
 #include <string.h>
 
 static void create_threads();
 
 extern float g_quadtree_root_size;
-extern const int QUAD_COUNT;
+extern size_t g_quadtree_max_level;
+extern float g_quadtree_min_distance;
+
+extern vec3 g_cameraPosition;
+extern mat4 g_projectionMatrix, g_viewMatrix;
 
 struct thread_state {
 	pthread_t thread;
@@ -39,210 +52,633 @@ struct generation_request_buffer_data {
 struct generation_request {
 	int x_coord, z_coord;
 	size_t level, tessellations;
+	size_t morph_tessellations; // the parent's mesh resolution over the chunk, see addTessellatedQuadMorphHeights
+	float *morph_heights; // the parent's grid heights at that resolution, NULL without a parent chunk
 
 	float x_pos, z_pos, size;
+	float min_height, max_height; // bounds the chunk's heights, for the frustum test
 
 	void *vertices, *normals;
 	size_t verticesCount, normalsCount;
 
+	// the chunk's own triangle list with ADAPTIVE_MESH, the shared one otherwise
+	unsigned int *indices;
+	size_t indicesCount;
+
+	// the parent chunk's fields to upsample from, and the ones this chunk leaves for its children
+	NoiseFieldGrid *parent_fields, *fields;
+
+	// measured roughness, deciding the children's tessellations, and measured heights, bounding the children's
+	float roughness;
+	float grid_min_height, grid_max_height;
+
 	struct generation_request_buffer_data vertices_vbo_data;
 	struct generation_request_buffer_data normals_vbo_data;
+	struct generation_request_buffer_data indices_vbo_data;
 
 	boolval pending, done, fetched;
+	size_t serial; // counts the slot's requests, handles to earlier ones are stale
 };
 struct generation_request pending_requests[MAX_PENDING_REQUESTS];
 
-boolval pending_fetches = false;
 pthread_mutex_t pending_requests_mtx;
 static boolval g_threads_running = false;
 
-void initialize_generator()
-{
-
-	pthread_mutex_init( &threads_mtx, NULL );
-	pthread_mutex_init( &pending_requests_mtx, NULL );
+// the pending requests' slots, most important first, and the slots free to make new ones in: workers sleep on
+// g_requests_available while the queue is empty, instead of scanning the slots
+static PriorityQueue *g_request_queue = NULL;
+static int g_free_requests[ MAX_PENDING_REQUESTS ];
+static size_t g_free_request_count = 0;
+static pthread_cond_t g_requests_available;
+static boolval g_unflushed_requests = false;
+
+// what a worker hands back for a request it took, the slot itself is only written by the main thread
+struct generation_result {
+	int request_index;
+	void *vertices, *normals;
+	size_t verticesCount, normalsCount;
+	unsigned int *indices;
+	size_t indicesCount;
+	NoiseFieldGrid *fields;
+	float roughness;
+	float min_height, max_height;
+};
 
-	pthread_mutex_lock( &threads_mtx );
-	g_threads_running = true;
-	pthread_mutex_unlock( &threads_mtx );
+// finished requests in the order they were finished, for poll_generator to integrate as its budget allows: workers push
+// them without taking any lock. A slot is only freed once its result is popped, so with room for one per slot a push
+// never finds the ring full
+#define COMPLETED_REQUESTS_CAPACITY MAX_PENDING_REQUESTS
+_Static_assert( COMPLETED_REQUESTS_CAPACITY >= MAX_PENDING_REQUESTS, "the completion ring needs room for a result per request slot" );
+static MpscRing *g_completed_requests = NULL;
+static size_t g_completed_peak = 0;
+
+// set from the main thread, read by the workers between the stages of a chunk
+static atomic_int g_cancelled_requests[ MAX_PENDING_REQUESTS ];
+
+// requests made, cancelled before a worker took them, and cancelled after
+static size_t g_requests_made = 0, g_requests_dropped = 0, g_requests_aborted = 0;
+
+// when the last stats line was printed, and the height cache's counts then; polls, chunks integrated, seconds spent
+// integrating and the deepest backlog since
+static double g_stats_time = 0;
+static size_t g_stats_cache_hits = 0, g_stats_cache_misses = 0;
+static size_t g_stats_polls = 0, g_stats_integrated = 0, g_stats_backlog_peak = 0;
+static double g_stats_poll_time = 0;
+
+// the camera the queued requests' priorities were computed for
+static mat4 g_priority_view_projection;
+static vec4 g_priority_planes[ 6 ];
+static vec3 g_priority_camera;
+
+// how much the chunk's vertex spacing covers on screen, from the nearest point of its bounding box: chunks that would
+// look the most wrong while missing come first, and the ones outside the view frustum after the ones in it
+static float get_request_priority( int request_index, void *data )
+{
+	const struct generation_request *request = &pending_requests[ request_index ];
+	vec3 box[ 2 ] = {
+		{ request->x_pos, request->min_height, request->z_pos },
+		{ request->x_pos + request->size, request->max_height, request->z_pos + request->size }
+	};
+
+	float squared_distance = 0;
+	for ( size_t i = 0; i < 3; ++i ){
+		const float outside = fmaxf( box[ 0 ][ i ] - g_priority_camera[ i ], g_priority_camera[ i ] - box[ 1 ][ i ] );
+		if ( outside > 0 ) squared_distance += outside * outside;
+	}
 
-	pthread_mutex_lock( &pending_requests_mtx );
+	const float spacing = request->size / pow( 2, request->tessellations );
+	float priority = spacing / fmaxf( sqrtf( squared_distance ), spacing );
+	if ( !glm_aabb_frustum( box, g_priority_planes ) )
+		priority *= GENERATION_PRIORITY_OUTSIDE_FRUSTUM;
+	return priority;
+}
 
-	for ( size_t i = 0; i < MAX_PENDING_REQUESTS; ++i ){
-		pending_requests[i].pending = false;
-		pending_requests[i].done = true;
-		pending_requests[i].fetched = true;
-	}
+// recomputes every queued request's priority if the camera moved since the last time
+static void update_request_priorities()
+{
+	mat4 view_projection;
+	glm_mat4_mul( g_projectionMatrix, g_viewMatrix, view_projection );
+	if ( memcmp( view_projection, g_priority_view_projection, sizeof( mat4 ) ) == 0 ) return;
 
-	pthread_mutex_unlock( &pending_requests_mtx );
+	glm_mat4_copy( view_projection, g_priority_view_projection );
+	glm_frustum_planes( view_projection, g_priority_planes );
+	glm_vec3_copy( g_cameraPosition, g_priority_camera );
 
-	create_threads();
+	reprioritize_priority_queue( g_request_queue, get_request_priority, NULL );
 }
 
-extern Material g_defaultTerrainMaterialLit;
-extern GLFWwindow* g_window;
-
-void poll_generator()
+// frees what the request holds in memory, any thread
+static void free_request_data( struct generation_request *request )
 {
-	pthread_mutex_lock( &pending_requests_mtx );
+	free( request->vertices );
+	free( request->normals );
+	free( request->indices );
+	free( request->morph_heights );
+	delete_noise_field_grid( request->parent_fields );
+	delete_noise_field_grid( request->fields );
+	request->vertices = NULL;
+	request->normals = NULL;
+	request->indices = NULL;
+	request->morph_heights = NULL;
+	request->parent_fields = NULL;
+	request->fields = NULL;
+}
 
-	if ( pending_fetches == false ) {
-		pthread_mutex_unlock( &pending_requests_mtx );
-		return;
-	}
+// gives a request's buffers back to their pools, main thread only
+static void yield_request_buffers( struct generation_request *request )
+{
+	yield_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_HEIGHTS, request->tessellations ), request->vertices_vbo_data.buffer_id );
+	yield_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_NORMALS, request->tessellations ), request->normals_vbo_data.buffer_id );
+	if ( ADAPTIVE_MESH )
+		yield_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_INDICES, request->tessellations ), request->indices_vbo_data.buffer_id );
+}
 
-	for ( size_t i = 0; i < MAX_PENDING_REQUESTS; ++i ){
+// the free slots are only touched from the main thread
+static void free_request_slot( size_t request_index )
+{
+	pending_requests[ request_index ].pending = false;
+	pending_requests[ request_index ].done = true;
+	pending_requests[ request_index ].fetched = true;
+	g_free_requests[ g_free_request_count++ ] = request_index;
+}
 
-		if ( pending_requests[i].pending == false && pending_requests[i].done == true && pending_requests[i].fetched == false ) {
+static boolval is_request_cancelled( int request_index )
+{
+	return atomic_load_explicit( &g_cancelled_requests[ request_index ], memory_order_relaxed );
+}
 
-			pending_requests[i].fetched = true;
+// a worker blocked on the queue also has to wake up for a large chunk's loop, see parallel.h
+static void wake_generator_threads()
+{
+	pthread_mutex_lock( &pending_requests_mtx );
+	pthread_cond_broadcast( &g_requests_available );
+	pthread_mutex_unlock( &pending_requests_mtx );
+}
 
-		/*	glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].vertices_vbo_data.buffer_id );
-			glUnmapBuffer( GL_ARRAY_BUFFER );
-			glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].normals_vbo_data.buffer_id );
-			glUnmapBuffer( GL_ARRAY_BUFFER );*/
+void initialize_generator()
+{
 
-			float requested_terrain_size = g_quadtree_root_size / pow( 2, pending_requests[i].level );
-			float x_pos = pending_requests[i].x_coord * requested_terrain_size, z_pos = pending_requests[i].z_coord * requested_terrain_size;
+	pthread_mutex_init( &threads_mtx, NULL );
+	pthread_mutex_init( &pending_requests_mtx, NULL );
+	pthread_cond_init( &g_requests_available, NULL );
 
-			PerspectiveObject *requested_terrain = createPerspectiveObject( );
+	set_parallel_loop_helpers( MAX_THREADS );
+	set_parallel_loop_wakeup( wake_generator_threads );
 
-			requested_terrain->position.x = x_pos;
-			requested_terrain->position.y = 0;
-			requested_terrain->position.z = z_pos;
+	pthread_mutex_lock( &pending_requests_mtx );
 
-			glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].vertices_vbo_data.buffer_id );
-			glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( float ) * pending_requests[i].verticesCount * 3, pending_requests[i].vertices );
+	g_threads_running = true;
+	g_request_queue = create_priority_queue( MAX_PENDING_REQUESTS );
+	g_unflushed_requests = false;
+	g_completed_requests = create_mpsc_ring( COMPLETED_REQUESTS_CAPACITY, sizeof( struct generation_result ) );
+	glm_mat4_zero( g_priority_view_projection );
+
+	// taken from the end, so slot 0 goes first
+	g_free_request_count = 0;
+	for ( size_t i = MAX_PENDING_REQUESTS; i-- > 0; ){
+		pending_requests[i].serial = 0;
+		atomic_init( &g_cancelled_requests[ i ], false );
+		free_request_slot( i );
+	}
 
-			glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].normals_vbo_data.buffer_id );
-			glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( float ) * pending_requests[i].normalsCount * 3, pending_requests[i].normals );
+	pthread_mutex_unlock( &pending_requests_mtx );
 
+	// the deepest level's finest vertex spacing, every chunk's samples lie on its lattice. Hierarchical synthesis
+	// upsamples its parent's fields instead, and never goes through the cache
+	if ( !HIERARCHICAL_SYNTHESIS )
+		initialize_height_cache( g_quadtree_root_size / pow( 2, g_quadtree_max_level + MAX_TESSELLATIONS ) );
 
-			setObjectVBO(
-				requested_terrain, 
-				pending_requests[i].vertices_vbo_data.buffer_id, 
-				VERTICES
-			);
-			setObjectVBO(
-				requested_terrain, 
-				pending_requests[i].normals_vbo_data.buffer_id, 
-				NORMALS
-			);
+	create_threads();
+}
 
-			//free( pending_requests[i].vertices );
-			//free( pending_requests[i].normals );
+extern Material g_defaultTerrainMaterialLit;
+extern GLFWwindow* g_window;
 
-			requested_terrain->material = &g_defaultTerrainMaterialLit;
-			requested_terrain->vertices = pending_requests[i].verticesCount;
+// uploads a finished request's chunk and pushes it to the quadtree
+static void integrate_request( size_t i )
+{
+	/*glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].vertices_vbo_data.buffer_id );
+	glUnmapBuffer( GL_ARRAY_BUFFER );
+	glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].normals_vbo_data.buffer_id );
+	glUnmapBuffer( GL_ARRAY_BUFFER );*/
+
+	float requested_terrain_size = g_quadtree_root_size / pow( 2, pending_requests[i].level );
+	float x_pos = pending_requests[i].x_coord * requested_terrain_size, z_pos = pending_requests[i].z_coord * requested_terrain_size;
+
+	PerspectiveObject *requested_terrain = createPerspectiveObject( );
+
+	requested_terrain->position.x = x_pos;
+	requested_terrain->position.y = 0;
+	requested_terrain->position.z = z_pos;
+
+	glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].vertices_vbo_data.buffer_id );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( float ) * pending_requests[i].verticesCount * ( CDLOD_MORPH ? 2 : 1 ), pending_requests[i].vertices );
+
+	glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].normals_vbo_data.buffer_id );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( short ) * pending_requests[i].normalsCount * 2, pending_requests[i].normals );
+
+
+	setObjectVBO(
+		requested_terrain, 
+		pending_requests[i].vertices_vbo_data.buffer_id, 
+		VERTICES
+	);
+	setObjectVBO(
+		requested_terrain, 
+		pending_requests[i].normals_vbo_data.buffer_id, 
+		NORMALS
+	);
+
+	//free( pending_requests[i].vertices );
+	//free( pending_requests[i].normals );
+
+	size_t indices_count = 0;
+	GLuint index_buffer;
+	if ( ADAPTIVE_MESH ){
+		index_buffer = pending_requests[i].indices_vbo_data.buffer_id;
+		indices_count = pending_requests[i].indicesCount;
+		glBindBuffer( GL_ARRAY_BUFFER, index_buffer );
+		glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( unsigned int ) * indices_count, pending_requests[i].indices );
+		free( pending_requests[i].indices );
+		pending_requests[i].indices = NULL;
+	}else{
+		index_buffer = get_quadtree_index_buffer( pending_requests[i].tessellations, &indices_count );
+	}
+	setObjectVBO( requested_terrain, index_buffer, INDICES );
+
+	requested_terrain->material = &g_defaultTerrainMaterialLit;
+	requested_terrain->vertices = pending_requests[i].verticesCount;
+	requested_terrain->indices = indices_count;
+
+	requested_terrain->gridMesh = true;
+	requested_terrain->gridSideVertices = pow( 2, pending_requests[i].tessellations ) + 1;
+	requested_terrain->gridSpacing = requested_terrain_size / ( requested_terrain->gridSideVertices - 1 );
+
+	// morphs into the parent's mesh as the camera gets to the distance where the parent takes over
+	requested_terrain->gridMorph = CDLOD_MORPH && pending_requests[i].level > 0;
+	requested_terrain->morphEnd = g_quadtree_min_distance / pow( 2, ( int ) pending_requests[i].level - 1 );
+	requested_terrain->morphStart = requested_terrain->morphEnd * CDLOD_MORPH_START;
+
+	push_quadtree_chunk( 
+		pending_requests[i].x_coord, 
+		pending_requests[i].z_coord, 
+		pending_requests[i].level, 
+		requested_terrain,
+		pending_requests[i].vertices,
+		pending_requests[i].normals,
+		pending_requests[i].fields,
+		pending_requests[i].roughness,
+		pending_requests[i].grid_min_height,
+		pending_requests[i].grid_max_height
+	);
+	pending_requests[i].fields = NULL;
+}
 
-			push_quadtree_chunk( 
-				pending_requests[i].x_coord, 
-				pending_requests[i].z_coord, 
-				pending_requests[i].level, 
-				requested_terrain,
-				pending_requests[i].vertices,
-				pending_requests[i].normals
-			);
+// what integrating a finished request uploads
+static size_t get_request_upload_size( const struct generation_request *request )
+{
+	size_t size = sizeof( float ) * request->verticesCount * ( CDLOD_MORPH ? 2 : 1 ) + sizeof( short ) * request->normalsCount * 2;
+	if ( ADAPTIVE_MESH ) size += sizeof( unsigned int ) * request->indicesCount;
+	return size;
+}
 
-			pthread_mutex_unlock( &pending_requests_mtx );
-			return;
+// one line of what the generator did since the previous one
+static void print_generator_stats()
+{
+	size_t cache_hits, cache_misses;
+	get_height_cache_stats( &cache_hits, &cache_misses );
+	const size_t hits = cache_hits - g_stats_cache_hits, misses = cache_misses - g_stats_cache_misses;
+	g_stats_cache_hits = cache_hits;
+	g_stats_cache_misses = cache_misses;
+	g_stats_time = glfwGetTime();
+
+	if ( g_stats_polls > 0 && ( g_stats_integrated > 0 || g_stats_backlog_peak > 0 ) )
+		printf( "Generator: backlog %zu (%zu at most), %zu chunks integrated, %.2fms a frame of a %gms budget\n",
+			get_generator_backlog(), g_stats_backlog_peak, g_stats_integrated, g_stats_poll_time * 1000 / g_stats_polls, GENERATOR_POLL_BUDGET_MS );
+	if ( hits + misses > 0 )
+		printf( "Generator: height cache %.1f%% hit rate, %zu samples\n", 100.0 * hits / ( hits + misses ), hits + misses );
+
+	g_stats_polls = g_stats_integrated = g_stats_backlog_peak = 0;
+	g_stats_poll_time = 0;
+}
 
+void poll_generator()
+{
+	const double start = glfwGetTime();
+	size_t uploaded = 0, integrated = 0;
+
+	struct generation_result result;
+
+	const size_t backlog = get_generator_backlog();
+	if ( backlog > g_completed_peak ) g_completed_peak = backlog;
+	if ( backlog > g_stats_backlog_peak ) g_stats_backlog_peak = backlog;
+
+	// workers only touch queued slots, and cancelling happens on this thread: no lock needed
+	while ( peek_mpsc_ring( g_completed_requests, &result ) ){
+		const size_t i = result.request_index;
+		pending_requests[i].vertices = result.vertices;
+		pending_requests[i].normals = result.normals;
+		pending_requests[i].verticesCount = result.verticesCount;
+		pending_requests[i].normalsCount = result.normalsCount;
+		pending_requests[i].indices = result.indices;
+		pending_requests[i].indicesCount = result.indicesCount;
+		pending_requests[i].fields = result.fields;
+		pending_requests[i].roughness = result.roughness;
+		pending_requests[i].grid_min_height = result.min_height;
+		pending_requests[i].grid_max_height = result.max_height;
+
+		// cancelled after a worker took it: nothing to show, the buffers are free again
+		if ( is_request_cancelled( i ) ){
+			pop_mpsc_ring( g_completed_requests, &result );
+			free_request_data( &pending_requests[i] );
+			yield_request_buffers( &pending_requests[i] );
+			free_request_slot( i );
+			++g_requests_aborted;
+			continue;
 		}
 
+		// at least one chunk a frame, however large
+		const size_t upload_size = get_request_upload_size( &pending_requests[i] );
+		if ( integrated > 0 && ( uploaded + upload_size > GENERATOR_POLL_BUDGET_BYTES || ( glfwGetTime() - start ) * 1000 >= GENERATOR_POLL_BUDGET_MS ) )
+			break;
+		pop_mpsc_ring( g_completed_requests, &result );
+
+		integrate_request( i );
+		free_request_slot( i );
+		uploaded += upload_size;
+		++integrated;
 	}
 
-	pending_fetches = false;
-	pthread_mutex_unlock( &pending_requests_mtx );
+	++g_stats_polls;
+	g_stats_integrated += integrated;
+	g_stats_poll_time += glfwGetTime() - start;
+	if ( GENERATOR_STATS_INTERVAL > 0 && glfwGetTime() - g_stats_time >= GENERATOR_STATS_INTERVAL )
+		print_generator_stats();
+}
+
+size_t get_generator_backlog()
+{
+	return get_mpsc_ring_length( g_completed_requests );
 }
 
 void terminate_generator()
 {
-	pthread_mutex_lock( &threads_mtx );
+	set_parallel_loop_helpers( 0 );
+	set_parallel_loop_wakeup( NULL );
+
+	pthread_mutex_lock( &pending_requests_mtx );
 	g_threads_running = false;
+	pthread_cond_broadcast( &g_requests_available );
+	pthread_mutex_unlock( &pending_requests_mtx );
+
+	// workers finish the chunk they are on, requests still queued are dropped
+	pthread_mutex_lock( &threads_mtx );
+	for ( size_t i = 0; i < MAX_THREADS; ++i )
+		pthread_join( threads[i].thread, NULL );
 	pthread_mutex_unlock( &threads_mtx );
 
 	pthread_mutex_destroy( &threads_mtx );
 	pthread_mutex_destroy( &pending_requests_mtx );
+	pthread_cond_destroy( &g_requests_available );
+	delete_priority_queue( g_request_queue );
+	g_request_queue = NULL;
+	delete_mpsc_ring( g_completed_requests );
+	g_completed_requests = NULL;
+
+	if ( g_requests_made > 0 )
+		printf( "Generator: %zu requests, %zu cancelled before starting, %zu after, at most %zu finished ones waiting\n", g_requests_made, g_requests_dropped, g_requests_aborted, g_completed_peak );
+
+	size_t cache_hits, cache_misses;
+	get_height_cache_stats( &cache_hits, &cache_misses );
+	if ( cache_hits + cache_misses > 0 )
+		printf( "Height cache: %zu hits, %zu misses, %.1f%% hit rate\n", cache_hits, cache_misses, 100.0 * cache_hits / ( cache_hits + cache_misses ) );
+	terminate_height_cache();
 }
 
-int find_request_index( boolval pending_predicate, boolval done_predicate, boolval fetched_predicate )
+// the three other children of the most important request's parent, when they are all queued at the same resolution:
+// indices in child order ( z % 2 * 2 + x % 2 ), the most important request's included. Found ones are taken off the queue
+static boolval find_sibling_requests( int *destination )
 {
-	for ( size_t i = 0; i < MAX_PENDING_REQUESTS; ++i ){
-		if ( pending_requests[ i ].pending == pending_predicate && pending_requests[ i ].done == done_predicate && pending_requests[ i ].fetched == fetched_predicate )
-			return i;
+	const struct generation_request *request = &pending_requests[ get_priority_queue_item( g_request_queue, 0 ) ];
+	if ( request->level == 0 ) return false;
+
+	size_t found = 0;
+	for ( size_t i = 0; i < 4; ++i ) destination[ i ] = -1;
+
+	for ( size_t i = 0; i < get_priority_queue_length( g_request_queue ) && found < 4; ++i ){
+		const int sibling_index = get_priority_queue_item( g_request_queue, i );
+		const struct generation_request *sibling = &pending_requests[ sibling_index ];
+		if ( sibling->level != request->level || sibling->tessellations != request->tessellations || sibling->morph_tessellations != request->morph_tessellations ) continue;
+		if ( sibling->x_coord / 2 != request->x_coord / 2 || sibling->z_coord / 2 != request->z_coord / 2 ) continue;
+
+		const size_t child_index = sibling->z_coord % 2 * 2 + sibling->x_coord % 2;
+		if ( destination[ child_index ] != -1 ) continue;
+		destination[ child_index ] = sibling_index;
+		++found;
 	}
+	if ( found < 4 ) return false;
 
-	return -1;
+	for ( size_t i = 0; i < 4; ++i )
+		remove_priority_queue( g_request_queue, destination[ i ] );
+	return true;
 }
 
-void *thread_job( void *data )
+// turns a chunk's height grid mesh into what gets uploaded: adaptive indices, skirts and morph heights
+static void finish_request( struct generation_request *request, float *vertices, short *normals, size_t verticesCount, size_t normalsCount )
 {
-	pthread_t self = pthread_self();
-
-	boolval running = true;
-
-	while ( running ) {
+	// the grid heights come first, skirts and morph heights are appended after them
+	request->roughness = getTessellatedQuadRoughness( vertices, request->tessellations, request->size );
+	getTessellatedQuadHeightBounds( vertices, request->tessellations, &request->grid_min_height, &request->grid_max_height );
+
+	unsigned int *indices = NULL;
+	size_t indicesCount = 0;
+	if ( ADAPTIVE_MESH ){
+		float *errors = computeTessellatedQuadErrors( vertices, request->tessellations );
+		indices = generateTessellatedQuadAdaptiveIndices( errors, request->tessellations, request->size * ADAPTIVE_MESH_MAX_ERROR, CHUNK_SKIRTS, &indicesCount );
+		if ( VERTEX_CACHE_OPTIMIZATION ) optimizeVertexCacheOrder( indices, indicesCount );
+		free( errors );
+	}
 
-		pthread_mutex_lock( &threads_mtx );
-		running = g_threads_running;
-		pthread_mutex_unlock( &threads_mtx );
+	if ( CHUNK_SKIRTS )
+		addTessellatedQuadSkirts( &vertices, &normals, request->tessellations, request->size * CHUNK_SKIRT_DEPTH, &verticesCount, &normalsCount );
+	// into the heights the parent chunk renders with, which hierarchical synthesis leaves off a full evaluation
+	if ( CDLOD_MORPH )
+		addTessellatedQuadMorphHeights( &vertices, request->tessellations, request->morph_tessellations, request->morph_heights, verticesCount );
+	free( request->morph_heights );
+	request->morph_heights = NULL;
+
+	request->vertices = vertices;
+	request->normals = normals;
+	request->verticesCount = verticesCount;
+	request->normalsCount = normalsCount;
+	request->indices = indices;
+	request->indicesCount = indicesCount;
+}
 
-		boolval found = false;
+static void generate_request( struct generation_request *request, int request_index )
+{
+	float *vertices = NULL;
+	short *normals = NULL;
+	size_t verticesCount, normalsCount;
 
-		int request_index;
-		struct generation_request request;
-		
-		pthread_mutex_lock( &pending_requests_mtx );
-		int search_result = find_request_index( true, false, false );	
+	if ( is_request_cancelled( request_index ) ) return;
 
-		if ( search_result != -1 ) {
-			found = true;
-			request_index = search_result;
-			request = pending_requests[ search_result ];
-		}
-		pthread_mutex_unlock( &pending_requests_mtx );	
+	if ( HIERARCHICAL_SYNTHESIS ){
+		const size_t samples = pow( 2, request->tessellations ) + 1;
+		float *heights = malloc( sizeof( float ) * samples * samples );
+		float *gradients = malloc( sizeof( float ) * samples * samples * 2 );
 
-		if ( found == false )
-		{
-			thread_sleep(50);
-			continue;
-		}
-		
-		float *vertices = NULL, *normals = NULL;
-		size_t verticesCount, normalsCount;
+		request->fields = terrain_heightmap_grid_hierarchical( request->x_pos, request->z_pos, request->size / ( samples - 1 ), samples, request->parent_fields, heights, gradients );
+		delete_noise_field_grid( request->parent_fields );
+		request->parent_fields = NULL;
 
+		generateTessellatedQuadFromGrid( &vertices, &normals, request->tessellations, request->size, heights, gradients, &verticesCount, &normalsCount );
+		free( heights );
+		free( gradients );
+	}else{
 		generateTessellatedQuad(
-			request.x_pos, 
-			request.z_pos, 
+			request->x_pos, 
+			request->z_pos, 
 			&vertices, 
 			&normals, 
-			request.tessellations, 
-			request.size, 
-			terrain_heightmap_func, 
+			request->tessellations, 
+			request->size, 
+			height_cache_grid, 
 			&verticesCount, 
 			&normalsCount
 		);
+	}
 
-		request.vertices = vertices;
-		request.normals = normals;
-		request.verticesCount = verticesCount;
-		request.normalsCount = normalsCount;
+	if ( is_request_cancelled( request_index ) ){
+		free( vertices );
+		free( normals );
+		return;
+	}
+	finish_request( request, vertices, normals, verticesCount, normalsCount );
+}
 
-		//memcpy( request.vertices_vbo_data.buffer_data, vertices, verticesCount * sizeof( float ) * 3 );
-		//memcpy( request.normals_vbo_data.buffer_data, normals, normalsCount * sizeof( float ) * 3 );
+// generates four sibling chunks, in child order, from one height field over their parent: the edges they share are
+// sampled once, and are the same samples on both sides
+static void generate_batch( struct generation_request *requests, const int *request_indices )
+{
+	size_t cancelled = 0;
+	for ( size_t i = 0; i < 4; ++i )
+		cancelled += is_request_cancelled( request_indices[ i ] );
+	if ( cancelled == 4 ) return;
+
+	const size_t samples = pow( 2, requests[ 0 ].tessellations ) + 1, batch_samples = 2 * samples - 1;
+	const float spacing = requests[ 0 ].size / ( samples - 1 );
+	float *batch_heights = malloc( sizeof( float ) * batch_samples * batch_samples );
+	float *batch_gradients = malloc( sizeof( float ) * batch_samples * batch_samples * 2 );
+	NoiseFieldGrid *batch_fields = NULL;
+
+	if ( HIERARCHICAL_SYNTHESIS ){
+		batch_fields = terrain_heightmap_grid_hierarchical( requests[ 0 ].x_pos, requests[ 0 ].z_pos, spacing, batch_samples, requests[ 0 ].parent_fields, batch_heights, batch_gradients );
+	}else{
+		sampleTessellatedQuadGrid( requests[ 0 ].x_pos, requests[ 0 ].z_pos, requests[ 0 ].tessellations + 1, requests[ 0 ].size * 2, height_cache_grid, batch_heights, batch_gradients );
+	}
 
-		request.pending = false;
-		request.done = true;
-		request.fetched = false;
+	float *heights = malloc( sizeof( float ) * samples * samples );
+	float *gradients = malloc( sizeof( float ) * samples * samples * 2 );
 
-		// data output
+	for ( size_t i = 0; i < 4; ++i ){
+		struct generation_request *request = &requests[ i ];
+		const size_t offset_x = i % 2 * ( samples - 1 ), offset_z = i / 2 * ( samples - 1 );
+
+		for ( size_t z = 0; z < samples; ++z ){
+			const size_t batch_row = ( offset_z + z ) * batch_samples + offset_x;
+			memcpy( heights + z * samples, batch_heights + batch_row, sizeof( float ) * samples );
+			memcpy( gradients + z * samples * 2, batch_gradients + batch_row * 2, sizeof( float ) * samples * 2 );
+		}
+
+		delete_noise_field_grid( request->parent_fields );
+		request->parent_fields = NULL;
+		if ( is_request_cancelled( request_indices[ i ] ) ) continue;
+		request->fields = slice_noise_field_grid( batch_fields, offset_x, offset_z, samples );
+
+		float *vertices = NULL;
+		short *normals = NULL;
+		size_t verticesCount, normalsCount;
+		generateTessellatedQuadFromGrid( &vertices, &normals, request->tessellations, request->size, heights, gradients, &verticesCount, &normalsCount );
+		finish_request( request, vertices, normals, verticesCount, normalsCount );
+	}
+
+	free( heights );
+	free( gradients );
+	free( batch_heights );
+	free( batch_gradients );
+	delete_noise_field_grid( batch_fields );
+}
+
+void *thread_job( void *data )
+{
+	while ( true ) {
+
+		// iterations of a large chunk being split across the threads come before new requests
+		if ( help_parallel_loop() )
+			continue;
+
+		// a request is taken off the queue and has its pending flag cleared, along with its siblings to generate in the
+		// same batch
+		struct generation_request requests[ 4 ];
+		int batch_indices[ 4 ];
+		size_t batch_size = 0;
 
 		pthread_mutex_lock( &pending_requests_mtx );
 
-		pending_requests[ request_index ] = request;
-		pending_fetches = true;	
+		while ( g_threads_running && get_priority_queue_length( g_request_queue ) == 0 && !is_parallel_loop_posted() )
+			pthread_cond_wait( &g_requests_available, &pending_requests_mtx );
 
-		pthread_mutex_unlock( &pending_requests_mtx );
+		if ( !g_threads_running ){
+			pthread_mutex_unlock( &pending_requests_mtx );
+			break;
+		}
+
+		if ( get_priority_queue_length( g_request_queue ) > 0 ) {
+			if ( BATCH_GENERATION && find_sibling_requests( batch_indices ) ){
+				batch_size = 4;
+			}else{
+				batch_indices[ 0 ] = pop_priority_queue( g_request_queue );
+				batch_size = 1;
+			}
+			for ( size_t i = 0; i < batch_size; ++i ){
+				pending_requests[ batch_indices[ i ] ].pending = false;
+				requests[ i ] = pending_requests[ batch_indices[ i ] ];
+			}
+		}
+		pthread_mutex_unlock( &pending_requests_mtx );	
+
+		// woken for a loop that was already finished by the others
+		if ( batch_size == 0 )
+			continue;
+
+		if ( batch_size == 4 )
+			generate_batch( requests, batch_indices );
+		else
+			generate_request( &requests[ 0 ], batch_indices[ 0 ] );
+
+		// data output
+
+		for ( size_t i = 0; i < batch_size; ++i ){
+			// cancelled while running, poll_generator only has its buffers left to yield
+			if ( is_request_cancelled( batch_indices[ i ] ) )
+				free_request_data( &requests[ i ] );
+
+			struct generation_result result = {
+				batch_indices[ i ],
+				requests[ i ].vertices, requests[ i ].normals,
+				requests[ i ].verticesCount, requests[ i ].normalsCount,
+				requests[ i ].indices,
+				requests[ i ].indicesCount,
+				requests[ i ].fields,
+				requests[ i ].roughness,
+				requests[ i ].grid_min_height, requests[ i ].grid_max_height
+			};
+			// never full, a slot has at most one result in it
+			const boolval pushed = push_mpsc_ring( g_completed_requests, &result );
+			assert( pushed );
+			( void ) pushed;
+		}
 
 	}
 
@@ -264,49 +700,103 @@ static void create_threads()
 	pthread_mutex_unlock( &threads_mtx );
 }
 
-boolval request_generation( int x_coord, int z_coord, size_t level, size_t tessellations )
+GenerationRequestHandle request_generation( int x_coord, int z_coord, size_t level, size_t tessellations, size_t morph_tessellations, NoiseFieldGrid *parent_fields, const float *morph_heights, float min_height, float max_height )
 {
 	float terrain_size = g_quadtree_root_size / pow( 2, level );
 
 	pthread_mutex_lock( &pending_requests_mtx );
 
-	boolval found = false;
+	GenerationRequestHandle handle = { -1, 0 };
 
-	for ( size_t i = 0; i < MAX_PENDING_REQUESTS; ++i ){
-		if ( pending_requests[i].pending == false && pending_requests[i].done == true && pending_requests[i].fetched == true ){
+	if ( g_free_request_count > 0 ){
+		const size_t i = g_free_requests[ --g_free_request_count ];
 
-			pending_requests[i].x_coord = x_coord;
-			pending_requests[i].z_coord = z_coord;
-			pending_requests[i].level = level;
+		pending_requests[i].x_coord = x_coord;
+		pending_requests[i].z_coord = z_coord;
+		pending_requests[i].level = level;
 
-			pending_requests[i].x_pos = x_coord * terrain_size;
-			pending_requests[i].z_pos = z_coord * terrain_size;
-			pending_requests[i].size = terrain_size;
+		pending_requests[i].x_pos = x_coord * terrain_size;
+		pending_requests[i].z_pos = z_coord * terrain_size;
+		pending_requests[i].size = terrain_size;
+		pending_requests[i].min_height = min_height;
+		pending_requests[i].max_height = max_height;
 
-			pending_requests[i].tessellations = tessellations;
+		pending_requests[i].tessellations = tessellations;
+		pending_requests[i].morph_tessellations = morph_tessellations;
+		pending_requests[i].morph_heights = NULL;
+		if ( morph_heights != NULL ){
+			const size_t morph_samples = pow( 2, morph_tessellations ) + 1;
+			pending_requests[i].morph_heights = malloc( sizeof( float ) * morph_samples * morph_samples );
+			memcpy( pending_requests[i].morph_heights, morph_heights, sizeof( float ) * morph_samples * morph_samples );
+		}
 
-			// vertices buffer
-			pending_requests[i].vertices_vbo_data.buffer_id = get_vbo_pool_buffer( "Quadtree" );
-			//glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].vertices_vbo_data.buffer_id );
-			//pending_requests[i].vertices_vbo_data.buffer_data = glMapBuffer( GL_ARRAY_BUFFER, GL_WRITE_ONLY );
+		pending_requests[i].parent_fields = HIERARCHICAL_SYNTHESIS ? retain_noise_field_grid( parent_fields ) : NULL;
+		pending_requests[i].fields = NULL;
+		pending_requests[i].vertices = NULL;
+		pending_requests[i].normals = NULL;
+
+		// vertices buffer
+		pending_requests[i].vertices_vbo_data.buffer_id = get_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_HEIGHTS, tessellations ) );
+		//glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].vertices_vbo_data.buffer_id );
+		//pending_requests[i].vertices_vbo_data.buffer_data = glMapBuffer( GL_ARRAY_BUFFER, GL_WRITE_ONLY );
+
+		// normals buffer
+		pending_requests[i].normals_vbo_data.buffer_id = get_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_NORMALS, tessellations ) );
+		//glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].normals_vbo_data.buffer_id );
+		//pending_requests[i].normals_vbo_data.buffer_data = glMapBuffer( GL_ARRAY_BUFFER, GL_WRITE_ONLY );
+
+		// indices buffer, adaptive meshes only
+		if ( ADAPTIVE_MESH )
+			pending_requests[i].indices_vbo_data.buffer_id = get_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_INDICES, tessellations ) );
+		pending_requests[i].indices = NULL;
+
+		pending_requests[i].pending = true;	
+		pending_requests[i].done = false;
+		pending_requests[i].fetched = false;
+		atomic_store_explicit( &g_cancelled_requests[ i ], false, memory_order_relaxed );
+		handle.index = i;
+		handle.serial = ++pending_requests[i].serial;
+		push_priority_queue( g_request_queue, i, get_request_priority( i, NULL ) );
+		g_unflushed_requests = true;
+		++g_requests_made;
+	}
 
-			// normals buffer
-			pending_requests[i].normals_vbo_data.buffer_id = get_vbo_pool_buffer( "Quadtree" );
-			//glBindBuffer( GL_ARRAY_BUFFER, pending_requests[i].normals_vbo_data.buffer_id );
-			//pending_requests[i].normals_vbo_data.buffer_data = glMapBuffer( GL_ARRAY_BUFFER, GL_WRITE_ONLY );
+	pthread_mutex_unlock( &pending_requests_mtx );
 
-			pending_requests[i].pending = true;	
-			pending_requests[i].done = false;
-			pending_requests[i].fetched = false;
-			found = true;
+	return handle;	
+}
 
-			break;
+void cancel_generation_request( GenerationRequestHandle handle )
+{
+	if ( handle.index < 0 ) return;
 
-		}
+	pthread_mutex_lock( &pending_requests_mtx );
+
+	// a free slot, or one holding a later request
+	struct generation_request *request = &pending_requests[ handle.index ];
+	if ( request->serial != handle.serial || request->fetched || is_request_cancelled( handle.index ) ){
+		pthread_mutex_unlock( &pending_requests_mtx );
+		return;
+	}
+	atomic_store_explicit( &g_cancelled_requests[ handle.index ], true, memory_order_relaxed );
+
+	// not taken by a worker yet, otherwise the worker and poll_generator let it go
+	if ( remove_priority_queue( g_request_queue, handle.index ) ){
+		free_request_data( request );
+		yield_request_buffers( request );
+		free_request_slot( handle.index );
+		++g_requests_dropped;
 	}
 
 	pthread_mutex_unlock( &pending_requests_mtx );
-
-	return !found;	
 }
 
+void flush_generation_requests()
+{
+	pthread_mutex_lock( &pending_requests_mtx );
+	update_request_priorities();
+	if ( g_unflushed_requests )
+		pthread_cond_broadcast( &g_requests_available );
+	g_unflushed_requests = false;
+	pthread_mutex_unlock( &pending_requests_mtx );
+}
@@ -4,13 +4,35 @@
 #include <stddef.h>
 
 #include "boolvals.h"
+#include "noisegraph.h"
 
 void initialize_generator();
+// integrates finished chunks, oldest first, until GENERATOR_POLL_BUDGET_MS or _BYTES is spent (at least one a call).
+// Prints a stats line every GENERATOR_STATS_INTERVAL seconds, none at 0: the backlog, next to the time spent against
+// the budget, and the height cache's hit rate
 void poll_generator();
 void terminate_generator();
 
-int find_request_index( boolval pending_predicate, boolval done_predicate, boolval fetched_predicate );
+// identifies a request until its chunk is pushed to the quadtree or it is cancelled, index is -1 when none could be made
+typedef struct GenerationRequestHandle {
+	int index;
+	size_t serial;
+} GenerationRequestHandle;
+
 void *thread_job( void* data );
-boolval request_generation( int x_coord, int z_coord, size_t level, size_t tessellations );
+// parent_fields, when not NULL, are the parent chunk's fields (see noisegraph.h), the request holds a reference to them
+// that its siblings share. They are only reused between chunks of the same tessellation. morph_tessellations is the resolution the chunk geomorphs into, and
+// morph_heights, when not NULL, the parent chunk's grid heights over it at that resolution, copied into the request;
+// without them it morphs into its own even vertices. Requests are generated most important first, by the screen space
+// size of their vertex spacing, which heights between min_height and max_height bound
+GenerationRequestHandle request_generation( int x_coord, int z_coord, size_t level, size_t tessellations, size_t morph_tessellations, NoiseFieldGrid *parent_fields, const float *morph_heights, float min_height, float max_height );
+// drops a queued request, or has a running one stop at its next check and its result thrown away. The request's buffers
+// go back to their pools either way. Stale handles are ignored
+void cancel_generation_request( GenerationRequestHandle handle );
+// wakes the workers for the requests made since the last call, they sleep until then. Queued requests are reordered
+// for the camera as it is now
+void flush_generation_requests();
+// finished chunks waiting for poll_generator, main thread only
+size_t get_generator_backlog();
 
 #endif
@@ -0,0 +1,216 @@
+#include "heightcache.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "boolvals.h"
+#include "noises.h"
+#include "config.h"
+
+/// definitions
+
+// the table is split in stripes, each with its own lock and buckets; a grid row lives in a single stripe
+#define HEIGHT_CACHE_STRIPE_BUCKETS ( HEIGHT_CACHE_ENTRIES / HEIGHT_CACHE_STRIPES / 2 )
+
+// detail is 0 for samples taken at full detail, the grid's lattice step when octaves were faded out
+struct height_cache_entry {
+	int32_t x, z, detail;
+	float height, dx, dz;
+	boolval used;
+};
+
+// two-way bucket, slot 0 holds the most recent insertion
+struct height_cache_bucket {
+	struct height_cache_entry slots[ 2 ];
+};
+
+struct height_cache_stripe {
+	pthread_mutex_t mtx;
+	struct height_cache_bucket *buckets;
+	size_t hits, misses;
+};
+
+static struct height_cache_stripe g_stripes[ HEIGHT_CACHE_STRIPES ];
+static float g_lattice_spacing = 0;
+static boolval g_initialized = false;
+
+/// static utils
+
+static uint32_t hash_coord( int32_t v )
+{
+	uint32_t h = ( uint32_t ) v * 0x9E3779B1u;
+	return h ^ ( h >> 15 );
+}
+
+static struct height_cache_stripe *get_row_stripe( int32_t z )
+{
+	return &g_stripes[ hash_coord( z ) & ( HEIGHT_CACHE_STRIPES - 1 ) ];
+}
+
+static struct height_cache_bucket *get_bucket( struct height_cache_stripe *stripe, int32_t x, int32_t z, int32_t detail )
+{
+	uint32_t h = hash_coord( x ) ^ ( hash_coord( z ) * 0x85EBCA6Bu ) ^ ( ( uint32_t ) detail * 0xC2B2AE35u );
+	return &stripe->buckets[ h & ( HEIGHT_CACHE_STRIPE_BUCKETS - 1 ) ];
+}
+
+// gradient may be NULL
+static boolval lookup( struct height_cache_bucket *bucket, int32_t x, int32_t z, int32_t detail, float *height, float *gradient )
+{
+	for ( size_t i = 0; i < 2; ++i ){
+		struct height_cache_entry *entry = &bucket->slots[ i ];
+		if ( entry->used && entry->x == x && entry->z == z && entry->detail == detail ){
+			*height = entry->height;
+			if ( gradient != NULL ){
+				gradient[ 0 ] = entry->dx;
+				gradient[ 1 ] = entry->dz;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+static void insert( struct height_cache_bucket *bucket, int32_t x, int32_t z, int32_t detail, float height, float dx, float dz )
+{
+	struct height_cache_entry entry = { x, z, detail, height, dx, dz, true };
+	bucket->slots[ 1 ] = bucket->slots[ 0 ];
+	bucket->slots[ 0 ] = entry;
+}
+
+// converts a position to lattice coordinates, returns false if it doesn't lie on the lattice
+static boolval to_lattice( float v, int32_t *result )
+{
+	float steps = roundf( v / g_lattice_spacing );
+	if ( fabsf( steps * g_lattice_spacing - v ) > g_lattice_spacing * 1e-3f ) return false;
+	*result = ( int32_t ) steps;
+	return true;
+}
+
+/// functions
+
+void initialize_height_cache( float lattice_spacing )
+{
+	g_lattice_spacing = lattice_spacing;
+	for ( size_t i = 0; i < HEIGHT_CACHE_STRIPES; ++i ){
+		pthread_mutex_init( &g_stripes[ i ].mtx, NULL );
+		g_stripes[ i ].buckets = calloc( HEIGHT_CACHE_STRIPE_BUCKETS, sizeof( struct height_cache_bucket ) );
+		g_stripes[ i ].hits = 0;
+		g_stripes[ i ].misses = 0;
+	}
+	g_initialized = true;
+}
+
+void terminate_height_cache()
+{
+	if ( !g_initialized ) return;
+	for ( size_t i = 0; i < HEIGHT_CACHE_STRIPES; ++i ){
+		pthread_mutex_destroy( &g_stripes[ i ].mtx );
+		free( g_stripes[ i ].buckets );
+		g_stripes[ i ].buckets = NULL;
+	}
+	g_initialized = false;
+}
+
+void clear_height_cache()
+{
+	for ( size_t i = 0; i < HEIGHT_CACHE_STRIPES; ++i ){
+		pthread_mutex_lock( &g_stripes[ i ].mtx );
+		for ( size_t b = 0; b < HEIGHT_CACHE_STRIPE_BUCKETS; ++b ){
+			g_stripes[ i ].buckets[ b ].slots[ 0 ].used = false;
+			g_stripes[ i ].buckets[ b ].slots[ 1 ].used = false;
+		}
+		pthread_mutex_unlock( &g_stripes[ i ].mtx );
+	}
+}
+
+void height_cache_grid( float x_origin, float z_origin, float spacing, size_t samples, float *destination, float *gradients )
+{
+	int32_t lattice_x, lattice_z, lattice_step;
+	if ( 
+		!g_initialized ||
+		!to_lattice( x_origin, &lattice_x ) || 
+		!to_lattice( z_origin, &lattice_z ) || 
+		!to_lattice( spacing, &lattice_step ) || 
+		lattice_step == 0 
+	){
+		terrain_heightmap_grid( x_origin, z_origin, spacing, samples, destination, gradients );
+		return;
+	}
+
+	// grids coarse enough to fade octaves only share samples with grids of their own spacing
+	const int32_t detail = spacing <= get_terrain_full_detail_spacing() ? 0 : lattice_step;
+
+	float *miss_x = malloc( sizeof( float ) * samples );
+	float *miss_heights = malloc( sizeof( float ) * samples * 3 );
+	float *miss_dx = miss_heights + samples, *miss_dz = miss_heights + samples * 2;
+	size_t *miss_indices = malloc( sizeof( size_t ) * samples );
+
+	for ( size_t row = 0; row < samples; ++row )
+	{
+		const int32_t z = lattice_z + ( int32_t ) row * lattice_step;
+		const float z_pos = z_origin + row*spacing;
+		float *row_destination = destination + row * samples;
+		float *row_gradients = gradients != NULL ? gradients + row * samples * 2 : NULL;
+		struct height_cache_stripe *stripe = get_row_stripe( z );
+		size_t misses = 0;
+
+		pthread_mutex_lock( &stripe->mtx );
+		for ( size_t i = 0; i < samples; ++i ){
+			const int32_t x = lattice_x + ( int32_t ) i * lattice_step;
+			if ( lookup( get_bucket( stripe, x, z, detail ), x, z, detail, row_destination + i, row_gradients ? row_gradients + i*2 : NULL ) ) continue;
+			miss_indices[ misses ] = i;
+			miss_x[ misses ] = x_origin + i*spacing;
+			++misses;
+		}
+		stripe->hits += samples - misses;
+		stripe->misses += misses;
+		pthread_mutex_unlock( &stripe->mtx );
+
+		if ( misses == 0 ) continue;
+
+		// entries always carry gradients so they can serve either kind of request
+		terrain_heightmap_row_gradient( miss_x, z_pos, misses, spacing, miss_heights, miss_dx, miss_dz );
+
+		pthread_mutex_lock( &stripe->mtx );
+		for ( size_t m = 0; m < misses; ++m ){
+			const size_t i = miss_indices[ m ];
+			const int32_t x = lattice_x + ( int32_t ) i * lattice_step;
+			row_destination[ i ] = miss_heights[ m ];
+			if ( row_gradients != NULL ){
+				row_gradients[ i*2 + 0 ] = miss_dx[ m ];
+				row_gradients[ i*2 + 1 ] = miss_dz[ m ];
+			}
+			insert( get_bucket( stripe, x, z, detail ), x, z, detail, miss_heights[ m ], miss_dx[ m ], miss_dz[ m ] );
+		}
+		pthread_mutex_unlock( &stripe->mtx );
+	}
+
+	free( miss_x );
+	free( miss_heights );
+	free( miss_indices );
+}
+
+void get_height_cache_stats( size_t *hits, size_t *misses )
+{
+	size_t total_hits = 0, total_misses = 0;
+	for ( size_t i = 0; i < HEIGHT_CACHE_STRIPES && g_initialized; ++i ){
+		pthread_mutex_lock( &g_stripes[ i ].mtx );
+		total_hits += g_stripes[ i ].hits;
+		total_misses += g_stripes[ i ].misses;
+		pthread_mutex_unlock( &g_stripes[ i ].mtx );
+	}
+	if ( hits != NULL ) *hits = total_hits;
+	if ( misses != NULL ) *misses = total_misses;
+}
+
+void reset_height_cache_stats()
+{
+	for ( size_t i = 0; i < HEIGHT_CACHE_STRIPES && g_initialized; ++i ){
+		pthread_mutex_lock( &g_stripes[ i ].mtx );
+		g_stripes[ i ].hits = 0;
+		g_stripes[ i ].misses = 0;
+		pthread_mutex_unlock( &g_stripes[ i ].mtx );
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef _HEIGHTCACHE_H_
+#define _HEIGHTCACHE_H_
+
+#include <stddef.h>
+
+// Concurrent cache of terrain height samples shared by the generator threads, when chunks are fully
+// evaluated (HIERARCHICAL_SYNTHESIS off; with it on, chunks come from their parent's fields and the
+// cache is not set up). Samples are keyed by their grid position on the deepest quadtree level's
+// lattice, so a (level, x, z) sample maps to ( x, z ) * 2^( max_level - level ): a child chunk finds
+// every other sample of its grid in its parent's entries, and neighbors share their edges.
+// Levels coarse enough to fade octaves out (see terrain_heightmap_row) get entries of their own: their
+// heights depend on the spacing, so they only share edges within the level, and only levels at full
+// detail reuse their parent's samples.
+// Uninitialized, height_cache_grid is terrain_heightmap_grid.
+
+void initialize_height_cache( float lattice_spacing );
+void terminate_height_cache();
+void clear_height_cache();
+
+// same contract as terrain_heightmap_grid, grids off the lattice bypass the cache
+void height_cache_grid( float x_origin, float z_origin, float spacing, size_t samples, float *destination, float *gradients );
+
+void get_height_cache_stats( size_t *hits, size_t *misses );
+void reset_height_cache_stats();
+
+#endif
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -21,6 +22,7 @@
 #include "renderer.h"
 #include "mempools.h"
 #include "vbopools.h"
+#include "config.h"
 
 #include "debug.h"
 
@@ -462,6 +464,10 @@ void render()
 
 int main( int argc, char* argv[] )
 {
+	// headless checks & benchmarks, e.g. renderer --bench noise-deviation
+	if ( argc > 2 && strcmp( argv[ 1 ], "--bench" ) == 0 )
+		return run_debug_benchmark( argv[ 2 ] );
+
 	boolval result = initialize();
 	if (result == true)
 		return true;
@@ -475,6 +481,14 @@ int main( int argc, char* argv[] )
 
 	initialize_workspace();
 
+	int terrainRecipeLength = 0;
+	char* terrainRecipe = getFile("assets/terrain/default.noise", &terrainRecipeLength);
+	if (terrainRecipe == NULL || !set_terrain_recipe(terrainRecipe)){
+		fprintf(stderr, "Couldn't load terrain recipe, using the builtin one\n");
+		set_terrain_recipe(NULL);
+	}
+	free(terrainRecipe);
+
 	initialize_generator();
 	initialize_quadtree();
 
@@ -521,23 +535,37 @@ int main( int argc, char* argv[] )
 
 	/*
 
+	//index list of both terrains, finer than any quadtree chunk's shared one
+
+	size_t tquadIndicesCount;
+	unsigned int* tquadIndices = generateTessellatedQuadIndices(8, CHUNK_SKIRTS, &tquadIndicesCount);
+	GLuint tquadIBO = createAndFillVBO(tquadIndices, tquadIndicesCount*sizeof(unsigned int), GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW);
+	free(tquadIndices);
+
 	//terrain 1
 
 	PerspectiveObject *terrain = createPerspectiveObject();
 
-	float *tquadVertices = NULL, *tquadNormals = NULL;
+	float *tquadVertices = NULL;
+	short *tquadNormals = NULL;
 	size_t tquadVerticesCount, tquadNormalsCount;
 
-	generateTessellatedQuad(terrain->position.x, terrain->position.z, &tquadVertices, &tquadNormals, 8, 500, terrain_heightmap_func, &tquadVerticesCount, &tquadNormalsCount);
+	generateTessellatedQuad(terrain->position.x, terrain->position.z, &tquadVertices, &tquadNormals, 8, 500, terrain_heightmap_grid, &tquadVerticesCount, &tquadNormalsCount);
+	if (CHUNK_SKIRTS) addTessellatedQuadSkirts(&tquadVertices, &tquadNormals, 8, 500 * CHUNK_SKIRT_DEPTH, &tquadVerticesCount, &tquadNormalsCount);
 
-	setObjectVBO(terrain, createAndFillVBO(tquadVertices, tquadVerticesCount*3*sizeof(float), GL_ARRAY_BUFFER, GL_STATIC_DRAW), VERTICES);
-	setObjectVBO(terrain, createAndFillVBO(tquadNormals, tquadNormalsCount*3*sizeof(float), GL_ARRAY_BUFFER, GL_STATIC_DRAW), NORMALS);
+	setObjectVBO(terrain, createAndFillVBO(tquadVertices, tquadVerticesCount*sizeof(float), GL_ARRAY_BUFFER, GL_STATIC_DRAW), VERTICES);
+	setObjectVBO(terrain, createAndFillVBO(tquadNormals, tquadNormalsCount*2*sizeof(short), GL_ARRAY_BUFFER, GL_STATIC_DRAW), NORMALS);
 
 	free( tquadVertices );
 	free( tquadNormals );
 
 	terrain->material = &g_defaultTerrainMaterialLit;
 	terrain->vertices = tquadVerticesCount;
+	setObjectVBO(terrain, tquadIBO, INDICES);
+	terrain->indices = tquadIndicesCount;
+	terrain->gridMesh = true;
+	terrain->gridSideVertices = 257;
+	terrain->gridSpacing = 500.0f / 256;
 
 	//terrain 2
 
@@ -545,19 +573,26 @@ int main( int argc, char* argv[] )
 
 	terrain2->position.x += 500;
 
-	float *tquad2Vertices = NULL, *tquad2Normals = NULL;
+	float *tquad2Vertices = NULL;
+	short *tquad2Normals = NULL;
 	size_t tquad2VerticesCount, tquad2NormalsCount;
 
-	generateTessellatedQuad(terrain2->position.x, terrain2->position.z, &tquad2Vertices, &tquad2Normals, 8, 500, terrain_heightmap_func, &tquad2VerticesCount, &tquad2NormalsCount);
+	generateTessellatedQuad(terrain2->position.x, terrain2->position.z, &tquad2Vertices, &tquad2Normals, 8, 500, terrain_heightmap_grid, &tquad2VerticesCount, &tquad2NormalsCount);
+	if (CHUNK_SKIRTS) addTessellatedQuadSkirts(&tquad2Vertices, &tquad2Normals, 8, 500 * CHUNK_SKIRT_DEPTH, &tquad2VerticesCount, &tquad2NormalsCount);
 
-	setObjectVBO(terrain2, createAndFillVBO(tquad2Vertices, tquad2VerticesCount*3*sizeof(float), GL_ARRAY_BUFFER, GL_STATIC_DRAW), VERTICES);
-	setObjectVBO(terrain2, createAndFillVBO(tquad2Normals, tquad2NormalsCount*3*sizeof(float), GL_ARRAY_BUFFER, GL_STATIC_DRAW), NORMALS);
+	setObjectVBO(terrain2, createAndFillVBO(tquad2Vertices, tquad2VerticesCount*sizeof(float), GL_ARRAY_BUFFER, GL_STATIC_DRAW), VERTICES);
+	setObjectVBO(terrain2, createAndFillVBO(tquad2Normals, tquad2NormalsCount*2*sizeof(short), GL_ARRAY_BUFFER, GL_STATIC_DRAW), NORMALS);
 
 	free( tquad2Vertices );
 	free( tquad2Normals );
 
 	terrain2->material = &g_defaultTerrainMaterialLit;
 	terrain2->vertices = tquad2VerticesCount;
+	setObjectVBO(terrain2, tquadIBO, INDICES);
+	terrain2->indices = tquadIndicesCount;
+	terrain2->gridMesh = true;
+	terrain2->gridSideVertices = 257;
+	terrain2->gridSpacing = 500.0f / 256;
 
 	*/
 
@@ -0,0 +1,97 @@
+#include "mpscring.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/// definitions
+
+// keeps the producers' tail and the consumer's head on cache lines of their own
+#define MPSC_RING_CACHE_LINE 64
+
+struct MpscRing {
+	size_t mask, element_size;
+	atomic_size_t *sequences; // per cell, its position once published, its position + capacity once popped
+	unsigned char *elements;
+	char tail_padding[ MPSC_RING_CACHE_LINE ];
+	atomic_size_t tail; // next position to claim
+	char head_padding[ MPSC_RING_CACHE_LINE ];
+	size_t head; // next position to pop
+};
+
+/// interface
+
+MpscRing *create_mpsc_ring( size_t capacity, size_t element_size )
+{
+	size_t cells = 1;
+	while ( cells < capacity ) cells *= 2;
+
+	MpscRing *ring = malloc( sizeof( MpscRing ) );
+	ring->mask = cells - 1;
+	ring->element_size = element_size;
+	ring->sequences = malloc( sizeof( atomic_size_t ) * cells );
+	ring->elements = malloc( element_size * cells );
+	for ( size_t i = 0; i < cells; ++i )
+		atomic_init( &ring->sequences[ i ], i );
+	atomic_init( &ring->tail, 0 );
+	ring->head = 0;
+
+	return ring;
+}
+
+void delete_mpsc_ring( MpscRing *ring )
+{
+	if ( ring == NULL ) return;
+	free( ring->sequences );
+	free( ring->elements );
+	free( ring );
+}
+
+boolval push_mpsc_ring( MpscRing *ring, const void *element )
+{
+	size_t position = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+
+	while ( true ){
+		const size_t sequence = atomic_load_explicit( &ring->sequences[ position & ring->mask ], memory_order_acquire );
+		const intptr_t lap = ( intptr_t ) sequence - ( intptr_t ) position;
+
+		// the cell is free at this position: claim it, or retry from wherever the producer that won got to
+		if ( lap == 0 ){
+			if ( atomic_compare_exchange_weak_explicit( &ring->tail, &position, position + 1, memory_order_relaxed, memory_order_relaxed ) )
+				break;
+		}else if ( lap < 0 ){
+			// not popped since the previous lap
+			return false;
+		}else{
+			position = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+		}
+	}
+
+	memcpy( ring->elements + ( position & ring->mask ) * ring->element_size, element, ring->element_size );
+	atomic_store_explicit( &ring->sequences[ position & ring->mask ], position + 1, memory_order_release );
+	return true;
+}
+
+boolval peek_mpsc_ring( MpscRing *ring, void *destination )
+{
+	const size_t cell = ring->head & ring->mask;
+	if ( atomic_load_explicit( &ring->sequences[ cell ], memory_order_acquire ) != ring->head + 1 ) return false;
+
+	memcpy( destination, ring->elements + cell * ring->element_size, ring->element_size );
+	return true;
+}
+
+boolval pop_mpsc_ring( MpscRing *ring, void *destination )
+{
+	if ( !peek_mpsc_ring( ring, destination ) ) return false;
+
+	atomic_store_explicit( &ring->sequences[ ring->head & ring->mask ], ring->head + ring->mask + 1, memory_order_release );
+	++ring->head;
+	return true;
+}
+
+size_t get_mpsc_ring_length( MpscRing *ring )
+{
+	return atomic_load_explicit( &ring->tail, memory_order_relaxed ) - ring->head;
+}
@@ -0,0 +1,30 @@
+#ifndef _MPSCRING_H_
+#define _MPSCRING_H_
+
+#include <stddef.h>
+
+#include "boolvals.h"
+
+// Bounded lock-free ring of fixed size elements, pushed from any number of threads and popped from a single one.
+// Every cell carries a sequence number: a producer claims a position with a compare-and-swap on the tail, copies its
+// element in and publishes it by advancing the cell's sequence; the consumer reads cells in order once published, and
+// hands them back a lap later. Neither side ever waits on a lock, a producer only retries when another one claimed the
+// same position first.
+
+typedef struct MpscRing MpscRing;
+
+// capacity is rounded up to a power of two
+MpscRing *create_mpsc_ring( size_t capacity, size_t element_size );
+void delete_mpsc_ring( MpscRing *ring );
+
+// any thread, false when the ring is full
+boolval push_mpsc_ring( MpscRing *ring, const void *element );
+
+// consumer thread only, false when the next element is not published yet
+boolval pop_mpsc_ring( MpscRing *ring, void *destination );
+boolval peek_mpsc_ring( MpscRing *ring, void *destination );
+
+// consumer thread only: elements claimed by producers and not popped yet, including ones still being copied in
+size_t get_mpsc_ring_length( MpscRing *ring );
+
+#endif
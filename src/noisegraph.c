@@ -0,0 +1,1265 @@
+#include "noisegraph.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+#include "boolvals.h"
+#include "config.h"
+#include "noises.h"
+#include "./../libs/perlin/perlin.h"
+
+/// definitions
+
+#define NOISE_GRAPH_MAX_NODES 128
+#define NOISE_GRAPH_MAX_INPUTS 3
+#define NOISE_GRAPH_MAX_NAME 32
+#define NOISE_PROGRAM_MAX_INSTRUCTIONS 512
+
+// samples the compiler averages an octave's input over, to know its expected value at each detail level
+#define NOISE_MEAN_ROWS 32
+#define NOISE_MEAN_SAMPLES 256
+#define NOISE_DETAIL_TABLE_SIZE 64
+#define NOISE_PROGRAM_MAX_DETAIL_TABLES 16
+
+enum NoiseNodeType {
+	NOISE_NODE_CONSTANT,
+	NOISE_NODE_VALUE,
+	NOISE_NODE_FREQUENCY,
+	NOISE_NODE_OCTAVES,
+	NOISE_NODE_RIDGE,
+	NOISE_NODE_ABS,
+	NOISE_NODE_SCALE,
+	NOISE_NODE_BIAS,
+	NOISE_NODE_ADD,
+	NOISE_NODE_WARP
+};
+
+// backend of a value node, NOISE_NODE_BACKEND_DEFAULT follows get_noise_backend()
+#define NOISE_NODE_BACKEND_DEFAULT -1
+
+struct noise_node_type_info {
+	const char *name;
+	enum NoiseNodeType type;
+	size_t min_inputs, max_inputs;
+};
+
+static const struct noise_node_type_info g_node_types[] = {
+	{ "constant", NOISE_NODE_CONSTANT, 0, 0 },
+	{ "value", NOISE_NODE_VALUE, 0, 0 },
+	{ "frequency", NOISE_NODE_FREQUENCY, 1, 1 },
+	{ "octaves", NOISE_NODE_OCTAVES, 1, 1 },
+	{ "ridge", NOISE_NODE_RIDGE, 1, 1 },
+	{ "abs", NOISE_NODE_ABS, 1, 1 },
+	{ "scale", NOISE_NODE_SCALE, 1, 1 },
+	{ "bias", NOISE_NODE_BIAS, 1, 1 },
+	{ "add", NOISE_NODE_ADD, 2, 2 },
+	{ "warp", NOISE_NODE_WARP, 2, 3 }
+};
+
+struct noise_node {
+	char name[ NOISE_GRAPH_MAX_NAME ];
+	enum NoiseNodeType type;
+	int inputs[ NOISE_GRAPH_MAX_INPUTS ];
+	size_t input_count;
+
+	float value, factor, offset, persistence, lacunarity, gain, amount;
+	int seed, octaves, count, backend;
+};
+
+enum NoiseOp {
+	NOISE_OP_CONST,		// dst = k0
+	NOISE_OP_VALUE,		// dst = k0 * pnoise( a * scale, b * scale ) + k1
+	NOISE_OP_ABS,		// dst = k2 * | k0 * a + k1 | + k3
+	NOISE_OP_LINEAR,	// dst = k0 * a + k1 * b + k2
+	NOISE_OP_DETAIL		// dst = k0 * a + k1 + k2 * ( mean - mean at spacing * scale ), from the detail table
+};
+
+struct noise_instruction {
+	enum NoiseOp op;
+	int dst, a, b;
+	float k[ 4 ];
+
+	// value sources
+	float scale, persistence;
+	int seed, octaves, backend;
+	boolval uniform_b;
+
+	// coarsest lattice frequency (cells per unit) of the innermost octave enclosing the instruction, 0 outside of any:
+	// the instruction is skipped once the octave weight there drops to 0
+	float skip_frequency;
+
+	// detail corrections: the octave's own coarsest frequency and table
+	float cull_frequency;
+	int table;
+
+	// value sources sampled at the input coordinates are fields a chunk's children can upsample instead of evaluating:
+	// field index or -1, bound on how much the output moves per unit of the raw noise, and sum( amplitude * frequency^2 )
+	// over the inner octaves, which scales the noise's second derivative bound
+	int field;
+	float sensitivity, curvature;
+};
+
+// expected value of an octave input as its finer inner octaves are left out: values[ j ] is the mean at a spacing of
+// 2^( first_log2 + j * step ) (in the input's own units), mean the one at full detail
+struct noise_detail_table {
+	float first_log2, step;
+	int count;
+	float mean;
+	float values[ NOISE_DETAIL_TABLE_SIZE ];
+};
+
+struct NoiseProgram {
+	struct noise_instruction instructions[ NOISE_PROGRAM_MAX_INSTRUCTIONS ];
+	size_t instruction_count;
+	int result;
+
+	// finest and coarsest lattice frequencies over the value sources
+	float max_value_frequency, min_value_frequency;
+
+	struct noise_detail_table tables[ NOISE_PROGRAM_MAX_DETAIL_TABLES ];
+	size_t table_count;
+
+	size_t field_count;
+};
+
+// registers 0 and 1 hold the input coordinates
+#define NOISE_REGISTER_X 0
+#define NOISE_REGISTER_Z 1
+
+// coordinates sources are evaluated at: registers scaled by a common factor
+struct noise_domain {
+	int x, z;
+	float scale;
+	boolval uniform_z;
+};
+
+// a compiled node's value: either a constant, or m * register + c
+struct noise_operand {
+	boolval constant;
+	float value;
+	int reg;
+	float m, c;
+};
+
+struct noise_compiler {
+	const struct noise_node *nodes;
+	NoiseProgram *program;
+	boolval registers[ NOISE_PROGRAM_MAX_REGISTERS ];
+	boolval failed;
+
+	// detail table of each octave input, built on demand, -1 until then
+	int node_tables[ NOISE_GRAPH_MAX_NODES ];
+};
+
+/// parsing
+
+static int find_node( const struct noise_node *nodes, size_t count, const char *name )
+{
+	for ( size_t i = 0; i < count; ++i ){
+		if ( strcmp( nodes[ i ].name, name ) == 0 ) return i;
+	}
+	return -1;
+}
+
+static boolval parse_parameter( struct noise_node *node, const char *key, const char *value )
+{
+	if ( strcmp( key, "backend" ) == 0 ){
+		if ( strcmp( value, "default" ) == 0 ) node->backend = NOISE_NODE_BACKEND_DEFAULT;
+		else if ( strcmp( value, "reference" ) == 0 ) node->backend = NOISE_BACKEND_REFERENCE;
+		else if ( strcmp( value, "fast" ) == 0 ) node->backend = NOISE_BACKEND_FAST;
+		else if ( strcmp( value, "simplex" ) == 0 ) node->backend = NOISE_BACKEND_SIMPLEX;
+		else return false;
+		return true;
+	}
+
+	char *end = NULL;
+	double number = strtod( value, &end );
+	if ( end == value || *end != '\0' ) return false;
+
+	if ( strcmp( key, "value" ) == 0 ) node->value = number;
+	else if ( strcmp( key, "factor" ) == 0 ) node->factor = number;
+	else if ( strcmp( key, "offset" ) == 0 ) node->offset = number;
+	else if ( strcmp( key, "persistence" ) == 0 ) node->persistence = number;
+	else if ( strcmp( key, "lacunarity" ) == 0 ) node->lacunarity = number;
+	else if ( strcmp( key, "gain" ) == 0 ) node->gain = number;
+	else if ( strcmp( key, "amount" ) == 0 ) node->amount = number;
+	else if ( strcmp( key, "seed" ) == 0 ) node->seed = ( int ) strtol( value, NULL, 10 );
+	else if ( strcmp( key, "octaves" ) == 0 ) node->octaves = ( int ) number;
+	else if ( strcmp( key, "count" ) == 0 ) node->count = ( int ) number;
+	else return false;
+	return true;
+}
+
+static void reset_node( struct noise_node *node )
+{
+	memset( node, 0, sizeof( struct noise_node ) );
+	node->factor = 1;
+	node->offset = 0.5;
+	node->persistence = 1;
+	node->lacunarity = 2;
+	node->gain = 0.5;
+	node->octaves = 4;
+	node->count = 1;
+	node->backend = NOISE_NODE_BACKEND_DEFAULT;
+}
+
+// parses a graph into nodes, returns the node count or -1
+static int parse_noise_graph( const char *source, struct noise_node *nodes )
+{
+	size_t count = 0, line_number = 0;
+	const char *line = source;
+
+	while ( *line != '\0' )
+	{
+		++line_number;
+		const char *line_end = strchr( line, '\n' );
+		size_t length = line_end ? ( size_t ) ( line_end - line ) : strlen( line );
+
+		char buffer[ 256 ];
+		if ( length >= sizeof( buffer ) ){
+			fprintf( stderr, "Noise graph line %zu is too long\n", line_number );
+			return -1;
+		}
+		memcpy( buffer, line, length );
+		buffer[ length ] = '\0';
+		line = line_end ? line_end + 1 : line + length;
+
+		char *comment = strchr( buffer, '#' );
+		if ( comment ) *comment = '\0';
+
+		char *tokens[ 16 ];
+		size_t token_count = 0;
+		for ( char *token = strtok( buffer, " \t\r" ); token && token_count < 16; token = strtok( NULL, " \t\r" ) )
+			tokens[ token_count++ ] = token;
+		if ( token_count == 0 ) continue;
+
+		if ( token_count < 3 || strcmp( tokens[ 1 ], "=" ) != 0 || strlen( tokens[ 0 ] ) >= NOISE_GRAPH_MAX_NAME ){
+			fprintf( stderr, "Noise graph line %zu: expected \"name = type ...\"\n", line_number );
+			return -1;
+		}
+		if ( count >= NOISE_GRAPH_MAX_NODES ){
+			fprintf( stderr, "Noise graph has more than %d nodes\n", NOISE_GRAPH_MAX_NODES );
+			return -1;
+		}
+		if ( find_node( nodes, count, tokens[ 0 ] ) >= 0 ){
+			fprintf( stderr, "Noise graph line %zu: %s is already defined\n", line_number, tokens[ 0 ] );
+			return -1;
+		}
+
+		struct noise_node *node = &nodes[ count ];
+		reset_node( node );
+		strcpy( node->name, tokens[ 0 ] );
+
+		const struct noise_node_type_info *info = NULL;
+		for ( size_t i = 0; i < sizeof( g_node_types ) / sizeof( g_node_types[ 0 ] ); ++i ){
+			if ( strcmp( g_node_types[ i ].name, tokens[ 2 ] ) == 0 ) info = &g_node_types[ i ];
+		}
+		if ( info == NULL ){
+			fprintf( stderr, "Noise graph line %zu: unknown node type %s\n", line_number, tokens[ 2 ] );
+			return -1;
+		}
+		node->type = info->type;
+
+		for ( size_t t = 3; t < token_count; ++t )
+		{
+			char *separator = strchr( tokens[ t ], '=' );
+			if ( separator ){
+				*separator = '\0';
+				if ( !parse_parameter( node, tokens[ t ], separator + 1 ) ){
+					fprintf( stderr, "Noise graph line %zu: bad parameter %s\n", line_number, tokens[ t ] );
+					return -1;
+				}
+				continue;
+			}
+
+			int input = find_node( nodes, count, tokens[ t ] );
+			if ( input < 0 || node->input_count >= info->max_inputs ){
+				fprintf( stderr, "Noise graph line %zu: bad input %s\n", line_number, tokens[ t ] );
+				return -1;
+			}
+			node->inputs[ node->input_count++ ] = input;
+		}
+
+		if ( node->input_count < info->min_inputs ){
+			fprintf( stderr, "Noise graph line %zu: %s needs %zu inputs\n", line_number, info->name, info->min_inputs );
+			return -1;
+		}
+
+		++count;
+	}
+
+	if ( count == 0 ){
+		fprintf( stderr, "Noise graph is empty\n" );
+		return -1;
+	}
+	return count;
+}
+
+/// compilation
+
+static int allocate_register( struct noise_compiler *compiler )
+{
+	for ( int i = NOISE_REGISTER_Z + 1; i < NOISE_PROGRAM_MAX_REGISTERS; ++i ){
+		if ( compiler->registers[ i ] ) continue;
+		compiler->registers[ i ] = true;
+		return i;
+	}
+	fprintf( stderr, "Noise graph needs more than %d registers\n", NOISE_PROGRAM_MAX_REGISTERS );
+	compiler->failed = true;
+	return NOISE_REGISTER_Z + 1;
+}
+
+static void release_register( struct noise_compiler *compiler, int reg )
+{
+	if ( reg > NOISE_REGISTER_Z ) compiler->registers[ reg ] = false;
+}
+
+static struct noise_instruction *emit( struct noise_compiler *compiler, enum NoiseOp op, int dst, int a, int b )
+{
+	NoiseProgram *program = compiler->program;
+	if ( program->instruction_count >= NOISE_PROGRAM_MAX_INSTRUCTIONS ){
+		if ( !compiler->failed ) fprintf( stderr, "Noise graph compiles to more than %d instructions\n", NOISE_PROGRAM_MAX_INSTRUCTIONS );
+		compiler->failed = true;
+		program->instruction_count = 0;
+	}
+	struct noise_instruction *instruction = &program->instructions[ program->instruction_count++ ];
+	memset( instruction, 0, sizeof( struct noise_instruction ) );
+	instruction->field = -1;
+	instruction->op = op;
+	instruction->dst = dst;
+	instruction->a = a;
+	instruction->b = b;
+	return instruction;
+}
+
+static struct noise_operand constant_operand( float value )
+{
+	struct noise_operand operand = { true, value, -1, 0, 0 };
+	return operand;
+}
+
+static struct noise_operand register_operand( int reg )
+{
+	struct noise_operand operand = { false, 0, reg, 1, 0 };
+	return operand;
+}
+
+static struct noise_operand combine_add( struct noise_compiler *compiler, struct noise_operand a, struct noise_operand b )
+{
+	if ( a.constant && b.constant ) return constant_operand( a.value + b.value );
+	if ( a.constant ){ b.c += a.value; return b; }
+	if ( b.constant ){ a.c += b.value; return a; }
+
+	struct noise_instruction *instruction = emit( compiler, NOISE_OP_LINEAR, a.reg, a.reg, b.reg );
+	instruction->k[ 0 ] = a.m;
+	instruction->k[ 1 ] = b.m;
+	instruction->k[ 2 ] = a.c + b.c;
+	release_register( compiler, b.reg );
+	return register_operand( a.reg );
+}
+
+static int get_node_detail_table( struct noise_compiler *compiler, int index );
+
+// evaluates the node in the given domain, multiplied by mul; sensitivity bounds how much the output moves per unit of
+// the node's ( multiplied ) value, INFINITY where that is not tracked
+static struct noise_operand compile_node( struct noise_compiler *compiler, int index, struct noise_domain domain, float mul, float sensitivity )
+{
+	const struct noise_node *node = &compiler->nodes[ index ];
+
+	// dead branch: nothing below contributes
+	if ( mul == 0 ) return constant_operand( 0 );
+
+	switch ( node->type )
+	{
+		case NOISE_NODE_CONSTANT:
+			return constant_operand( mul * node->value );
+
+		case NOISE_NODE_VALUE:{
+			int dst = allocate_register( compiler );
+			struct noise_instruction *instruction = emit( compiler, NOISE_OP_VALUE, dst, domain.x, domain.z );
+			instruction->k[ 0 ] = mul;
+			instruction->k[ 1 ] = 0;
+			instruction->scale = domain.scale;
+			instruction->persistence = node->persistence;
+			instruction->seed = node->seed;
+			instruction->octaves = node->octaves;
+			instruction->backend = node->backend;
+			instruction->uniform_b = domain.uniform_z;
+			const float coarsest = ldexpf( domain.scale, 1 - ( node->octaves > 1 ? node->octaves : 1 ) );
+			if ( domain.scale > compiler->program->max_value_frequency ) compiler->program->max_value_frequency = domain.scale;
+			if ( coarsest < compiler->program->min_value_frequency ) compiler->program->min_value_frequency = coarsest;
+
+			NoiseProgram *program = compiler->program;
+			if ( domain.x == NOISE_REGISTER_X && domain.z == NOISE_REGISTER_Z && isfinite( sensitivity ) && program->field_count < NOISE_PROGRAM_MAX_FIELDS ){
+				float curvature = 0, amplitude = 1;
+				for ( int o = 0; o < node->octaves; ++o ){
+					const float frequency = ldexpf( domain.scale, -o );
+					curvature += fabsf( amplitude ) * frequency * frequency;
+					amplitude *= node->persistence;
+				}
+				instruction->field = program->field_count++;
+				instruction->sensitivity = sensitivity * fabsf( mul );
+				instruction->curvature = curvature;
+			}
+			return register_operand( dst );
+		}
+
+		case NOISE_NODE_FREQUENCY:
+			domain.scale *= node->factor;
+			return compile_node( compiler, node->inputs[ 0 ], domain, mul, sensitivity );
+
+		case NOISE_NODE_OCTAVES:{
+			struct noise_operand sum = constant_operand( 0 );
+			float amplitude = mul;
+			struct noise_domain octave_domain = domain;
+			for ( int o = 0; o < node->count; ++o ){
+				const size_t first = compiler->program->instruction_count;
+				struct noise_operand term = compile_node( compiler, node->inputs[ 0 ], octave_domain, amplitude, sensitivity );
+				NoiseProgram *program = compiler->program;
+
+				// value sources drop their own inner octaves as they pass the sample rate, which shifts the octave's
+				// expected value (a ridge of smoother noise is higher on average): the detail instruction puts it back,
+				// and stands in for the whole octave once the coarsest inner octave of every source is gone too
+				float frequency = INFINITY;
+				for ( size_t i = first; i < program->instruction_count; ++i ){
+					const struct noise_instruction *source = &program->instructions[ i ];
+					if ( source->op != NOISE_OP_VALUE ) continue;
+					const float coarsest = ldexpf( source->scale, 1 - ( source->octaves > 1 ? source->octaves : 1 ) );
+					if ( coarsest < frequency ) frequency = coarsest;
+				}
+
+				if ( !term.constant && frequency != INFINITY && !compiler->failed ){
+					const int table = get_node_detail_table( compiler, node->inputs[ 0 ] );
+					for ( size_t i = first; i < program->instruction_count; ++i ){
+						if ( program->instructions[ i ].skip_frequency < frequency )
+							program->instructions[ i ].skip_frequency = frequency;
+					}
+
+					struct noise_instruction *instruction = emit( compiler, NOISE_OP_DETAIL, term.reg, term.reg, term.reg );
+					instruction->k[ 0 ] = term.m;
+					instruction->k[ 1 ] = term.c;
+					instruction->k[ 2 ] = amplitude;
+					instruction->scale = octave_domain.scale;
+					instruction->cull_frequency = frequency;
+					instruction->table = table;
+					term = register_operand( term.reg );
+				}
+
+				sum = combine_add( compiler, sum, term );
+				amplitude *= node->gain;
+				octave_domain.scale *= node->lacunarity;
+			}
+			return sum;
+		}
+
+		case NOISE_NODE_RIDGE:
+		case NOISE_NODE_ABS:{
+			// ridge( v ) = 1 - 2 * | v - offset |, abs( v ) = | v |
+			const boolval ridge = node->type == NOISE_NODE_RIDGE;
+			const float offset = ridge ? node->offset : 0;
+			struct noise_operand input = compile_node( compiler, node->inputs[ 0 ], domain, 1, sensitivity * fabsf( ridge ? 2 * mul : mul ) );
+
+			if ( input.constant )
+				return constant_operand( ridge ? mul * ( 1 - 2 * fabsf( input.value - offset ) ) : mul * fabsf( input.value ) );
+
+			struct noise_instruction *instruction = emit( compiler, NOISE_OP_ABS, input.reg, input.reg, input.reg );
+			instruction->k[ 0 ] = input.m;
+			instruction->k[ 1 ] = input.c - offset;
+			instruction->k[ 2 ] = ridge ? -2 * mul : mul;
+			instruction->k[ 3 ] = ridge ? mul : 0;
+			return register_operand( input.reg );
+		}
+
+		case NOISE_NODE_SCALE:
+			return compile_node( compiler, node->inputs[ 0 ], domain, mul * node->factor, sensitivity );
+
+		case NOISE_NODE_BIAS:{
+			struct noise_operand input = compile_node( compiler, node->inputs[ 0 ], domain, mul, sensitivity );
+			if ( input.constant ) input.value += mul * node->value;
+			else input.c += mul * node->value;
+			return input;
+		}
+
+		case NOISE_NODE_ADD:
+			return combine_add(
+				compiler,
+				compile_node( compiler, node->inputs[ 0 ], domain, mul, sensitivity ),
+				compile_node( compiler, node->inputs[ 1 ], domain, mul, sensitivity )
+			);
+
+		case NOISE_NODE_WARP:{
+			// displaced coordinates: scale * coordinate + amount * displacement, then evaluated unscaled
+			struct noise_domain warped = { domain.x, domain.z, 1, domain.uniform_z };
+			for ( size_t axis = 0; axis < 2; ++axis ){
+				const int coordinate = axis == 0 ? domain.x : domain.z;
+				struct noise_operand displacement = constant_operand( 0 );
+				if ( axis + 1 < node->input_count )
+					displacement = compile_node( compiler, node->inputs[ axis + 1 ], domain, node->amount, INFINITY );
+
+				int dst = displacement.constant ? allocate_register( compiler ) : displacement.reg;
+				struct noise_instruction *instruction = emit( compiler, NOISE_OP_LINEAR, dst, coordinate, displacement.constant ? coordinate : displacement.reg );
+				instruction->k[ 0 ] = domain.scale;
+				instruction->k[ 1 ] = displacement.constant ? 0 : displacement.m;
+				instruction->k[ 2 ] = displacement.constant ? displacement.value : displacement.c;
+
+				if ( axis == 0 ) warped.x = dst;
+				else{
+					warped.z = dst;
+					warped.uniform_z = domain.uniform_z && displacement.constant;
+				}
+			}
+
+			struct noise_operand result = compile_node( compiler, node->inputs[ 0 ], warped, mul, sensitivity );
+			release_register( compiler, warped.x );
+			release_register( compiler, warped.z );
+			return result;
+		}
+	}
+
+	return constant_operand( 0 );
+}
+
+// compiles a node in a fresh program, at unit scale
+static NoiseProgram *compile_program( const struct noise_node *nodes, int output )
+{
+	NoiseProgram *program = malloc( sizeof( NoiseProgram ) );
+	program->instruction_count = 0;
+	program->max_value_frequency = 0;
+	program->min_value_frequency = INFINITY;
+	program->table_count = 0;
+	program->field_count = 0;
+
+	struct noise_compiler *compiler = calloc( 1, sizeof( struct noise_compiler ) );
+	compiler->nodes = nodes;
+	compiler->program = program;
+	for ( size_t i = 0; i < NOISE_GRAPH_MAX_NODES; ++i )
+		compiler->node_tables[ i ] = -1;
+
+	struct noise_domain root_domain = { NOISE_REGISTER_X, NOISE_REGISTER_Z, 1, true };
+	struct noise_operand result = compile_node( compiler, output, root_domain, 1, 1 );
+
+	if ( result.constant ){
+		result.reg = allocate_register( compiler );
+		emit( compiler, NOISE_OP_CONST, result.reg, result.reg, result.reg )->k[ 0 ] = result.value;
+	}else if ( result.m != 1 || result.c != 0 ){
+		struct noise_instruction *instruction = emit( compiler, NOISE_OP_LINEAR, result.reg, result.reg, result.reg );
+		instruction->k[ 0 ] = result.m;
+		instruction->k[ 1 ] = 0;
+		instruction->k[ 2 ] = result.c;
+	}
+	program->result = result.reg;
+
+	const boolval failed = compiler->failed;
+	free( compiler );
+	if ( failed ){
+		free( program );
+		return NULL;
+	}
+	return program;
+}
+
+// averages a program over a patch of its lattice cells
+static float estimate_program_mean( const NoiseProgram *program, float spacing )
+{
+	float x[ NOISE_MEAN_SAMPLES ], values[ NOISE_MEAN_SAMPLES ];
+	for ( size_t i = 0; i < NOISE_MEAN_SAMPLES; ++i )
+		x[ i ] = 0.5f + i * 1.618034f;
+
+	double sum = 0;
+	for ( size_t row = 0; row < NOISE_MEAN_ROWS; ++row ){
+		run_noise_program_row( program, x, 0.5f + row * 7.31147f, NOISE_MEAN_SAMPLES, spacing, values );
+		for ( size_t i = 0; i < NOISE_MEAN_SAMPLES; ++i )
+			sum += values[ i ];
+	}
+	return sum / ( NOISE_MEAN_ROWS * NOISE_MEAN_SAMPLES );
+}
+
+// tabulates a node's expected value from the spacing its finest octave starts fading at, to the one its coarsest is
+// gone at; octave inputs are stationary, so the table holds at whatever frequency an octave places them
+static int get_node_detail_table( struct noise_compiler *compiler, int index )
+{
+	if ( compiler->node_tables[ index ] >= 0 ) return compiler->node_tables[ index ];
+
+	NoiseProgram *program = compiler->program;
+	if ( program->table_count >= NOISE_PROGRAM_MAX_DETAIL_TABLES ){
+		fprintf( stderr, "Noise graph needs more than %d detail tables\n", NOISE_PROGRAM_MAX_DETAIL_TABLES );
+		compiler->failed = true;
+		return 0;
+	}
+
+	NoiseProgram *input = compile_program( compiler->nodes, index );
+	if ( input == NULL ){
+		compiler->failed = true;
+		return 0;
+	}
+
+	struct noise_detail_table *table = &program->tables[ program->table_count ];
+	const float first_log2 = log2f( NOISE_OCTAVE_FADE_START / input->max_value_frequency );
+	const float last_log2 = log2f( NOISE_OCTAVE_FADE_END / input->min_value_frequency );
+
+	table->first_log2 = first_log2;
+	table->count = NOISE_DETAIL_TABLE_SIZE;
+	table->step = ( last_log2 - first_log2 ) / ( NOISE_DETAIL_TABLE_SIZE - 1 );
+	if ( table->step < 0.25f ){
+		table->step = 0.25f;
+		table->count = ( int ) ceilf( ( last_log2 - first_log2 ) / table->step ) + 1;
+	}
+
+	table->mean = estimate_program_mean( input, 0 );
+	for ( int j = 0; j < table->count; ++j )
+		table->values[ j ] = estimate_program_mean( input, exp2f( first_log2 + j * table->step ) );
+
+	delete_noise_program( input );
+	compiler->node_tables[ index ] = program->table_count;
+	return program->table_count++;
+}
+
+NoiseProgram *compile_noise_graph( const char *source )
+{
+	struct noise_node *nodes = malloc( sizeof( struct noise_node ) * NOISE_GRAPH_MAX_NODES );
+	int node_count = parse_noise_graph( source, nodes );
+	if ( node_count < 0 ){
+		free( nodes );
+		return NULL;
+	}
+
+	int output = find_node( nodes, node_count, "output" );
+	if ( output < 0 ) output = node_count - 1;
+
+	NoiseProgram *program = compile_program( nodes, output );
+	free( nodes );
+	return program;
+}
+
+void delete_noise_program( NoiseProgram *program )
+{
+	free( program );
+}
+
+size_t get_noise_program_instruction_count( const NoiseProgram *program )
+{
+	return program->instruction_count;
+}
+
+float get_noise_program_full_detail_spacing( const NoiseProgram *program )
+{
+	if ( program->max_value_frequency == 0 ) return INFINITY;
+	return NOISE_OCTAVE_FADE_START / program->max_value_frequency;
+}
+
+// weight of an octave whose finest lattice has the given frequency: 1 while there are at least 1 / NOISE_OCTAVE_FADE_START
+// samples per cell, easing to 0 at 1 / NOISE_OCTAVE_FADE_END
+static float get_octave_weight( float frequency, float spacing )
+{
+	const float cells_per_sample = frequency * spacing;
+	if ( cells_per_sample <= NOISE_OCTAVE_FADE_START ) return 1;
+	if ( cells_per_sample >= NOISE_OCTAVE_FADE_END ) return 0;
+	const float t = ( cells_per_sample - NOISE_OCTAVE_FADE_START ) / ( NOISE_OCTAVE_FADE_END - NOISE_OCTAVE_FADE_START );
+	return 1 - t * t * ( 3 - 2 * t );
+}
+
+static boolval is_instruction_culled( const struct noise_instruction *instruction, float spacing )
+{
+	return instruction->skip_frequency > 0 && get_octave_weight( instruction->skip_frequency, spacing ) == 0;
+}
+
+// how much a detail instruction shifts its octave by at the given spacing
+static float get_detail_correction( const NoiseProgram *program, const struct noise_instruction *instruction, float spacing )
+{
+	const struct noise_detail_table *table = &program->tables[ instruction->table ];
+	const float position = ( log2f( spacing * instruction->scale ) - table->first_log2 ) / table->step;
+	if ( !( position > 0 ) ) return 0;
+
+	float value;
+	if ( position >= table->count - 1 ){
+		value = table->values[ table->count - 1 ];
+	}else{
+		const int j = ( int ) position;
+		const float t = position - j;
+		value = table->values[ j ] + ( table->values[ j + 1 ] - table->values[ j ] ) * t;
+	}
+	return instruction->k[ 2 ] * ( table->mean - value );
+}
+
+// inner octaves of a value source to leave out, finest first (see pnoise2df_row_skip)
+static float get_value_skipped_octaves( const struct noise_instruction *instruction, float spacing )
+{
+	float skipped = 0;
+	for ( int o = 0; o < instruction->octaves; ++o ){
+		const float weight = get_octave_weight( ldexpf( instruction->scale, -o ), spacing );
+		if ( weight == 1 ) break;
+		skipped = o + 1 - weight;
+		if ( weight > 0 ) break;
+	}
+	return skipped;
+}
+
+// resolves NOISE_NODE_BACKEND_DEFAULT
+static int get_instruction_backend( const struct noise_instruction *instruction )
+{
+	return instruction->backend == NOISE_NODE_BACKEND_DEFAULT ? ( int ) get_noise_backend() : instruction->backend;
+}
+
+// bound on the bilinear interpolation error of a value source's raw noise, per squared sample spacing: over cells of
+// side h it is off by at most h^2 / 8 times the sum of its second derivative bounds along x and z. Value noise lattice
+// values are within [ -1, 1 ] and both fades bend by at most pi^2 / 2, which bounds each octave by pi^2 * frequency^2
+static float get_value_interpolation_error( const struct noise_instruction *instruction )
+{
+	const float bound = get_instruction_backend( instruction ) == NOISE_BACKEND_SIMPLEX ? SNOISE_MAX_SECOND_DERIVATIVE : ( float ) ( M_PI * M_PI );
+	return instruction->curvature * bound / 4;
+}
+
+/// evaluation
+
+static void run_value_instruction( const struct noise_instruction *instruction, float registers[][ NOISE_ROW_BLOCK ], size_t count, float spacing )
+{
+	const float *x = registers[ instruction->a ], *z = registers[ instruction->b ];
+	float *destination = registers[ instruction->dst ];
+	const float scale = instruction->scale;
+	const float skipped = get_value_skipped_octaves( instruction, spacing );
+	const int backend = get_instruction_backend( instruction );
+
+	if ( backend == NOISE_BACKEND_SIMPLEX ){
+		float scaled_x[ NOISE_ROW_BLOCK ];
+		for ( size_t i = 0; i < count; ++i )
+			scaled_x[ i ] = x[ i ] * scale;
+
+		if ( instruction->uniform_b ){
+			psnoise2df_row_skip( scaled_x, z[ 0 ] * scale, count, instruction->persistence, instruction->octaves, instruction->seed, skipped, destination );
+		}else{
+			for ( size_t i = 0; i < count; ++i )
+				psnoise2df_row_skip( scaled_x + i, z[ i ] * scale, 1, instruction->persistence, instruction->octaves, instruction->seed, skipped, destination + i );
+		}
+	}else if ( backend == NOISE_BACKEND_FAST ){
+		float scaled_x[ NOISE_ROW_BLOCK ];
+		for ( size_t i = 0; i < count; ++i )
+			scaled_x[ i ] = x[ i ] * scale;
+
+		if ( instruction->uniform_b ){
+			pnoise2df_row_simd_skip( scaled_x, z[ 0 ] * scale, count, instruction->persistence, instruction->octaves, instruction->seed, skipped, destination );
+		}else{
+			for ( size_t i = 0; i < count; ++i )
+				pnoise2df_row_skip( scaled_x + i, z[ i ] * scale, 1, instruction->persistence, instruction->octaves, instruction->seed, skipped, destination + i );
+		}
+	}else{
+		double scaled_x[ NOISE_ROW_BLOCK ], values[ NOISE_ROW_BLOCK ];
+		for ( size_t i = 0; i < count; ++i )
+			scaled_x[ i ] = x[ i ] * scale;
+
+		if ( instruction->uniform_b ){
+			pnoise2d_row_skip( scaled_x, z[ 0 ] * scale, count, instruction->persistence, instruction->octaves, instruction->seed, skipped, values );
+		}else{
+			for ( size_t i = 0; i < count; ++i )
+				pnoise2d_row_skip( scaled_x + i, z[ i ] * scale, 1, instruction->persistence, instruction->octaves, instruction->seed, skipped, values + i );
+		}
+		for ( size_t i = 0; i < count; ++i )
+			destination[ i ] = values[ i ];
+	}
+
+	if ( instruction->k[ 0 ] != 1 || instruction->k[ 1 ] != 0 ){
+		for ( size_t i = 0; i < count; ++i )
+			destination[ i ] = instruction->k[ 0 ] * destination[ i ] + instruction->k[ 1 ];
+	}
+}
+
+void run_noise_program_row( const NoiseProgram *program, const float *x, float z, size_t count, float spacing, float *destination )
+{
+	float registers[ NOISE_PROGRAM_MAX_REGISTERS ][ NOISE_ROW_BLOCK ];
+
+	for ( size_t block = 0; block < count; block += NOISE_ROW_BLOCK )
+	{
+		const size_t block_count = ( count - block ) < NOISE_ROW_BLOCK ? ( count - block ) : NOISE_ROW_BLOCK;
+
+		memcpy( registers[ NOISE_REGISTER_X ], x + block, sizeof( float ) * block_count );
+		for ( size_t i = 0; i < block_count; ++i )
+			registers[ NOISE_REGISTER_Z ][ i ] = z;
+
+		for ( size_t n = 0; n < program->instruction_count; ++n )
+		{
+			const struct noise_instruction *instruction = &program->instructions[ n ];
+			if ( is_instruction_culled( instruction, spacing ) ) continue;
+
+			float *dst = registers[ instruction->dst ];
+			const float *a = registers[ instruction->a ], *b = registers[ instruction->b ];
+			const float k0 = instruction->k[ 0 ], k1 = instruction->k[ 1 ], k2 = instruction->k[ 2 ], k3 = instruction->k[ 3 ];
+
+			switch ( instruction->op )
+			{
+				case NOISE_OP_CONST:
+					for ( size_t i = 0; i < block_count; ++i )
+						dst[ i ] = k0;
+					break;
+				case NOISE_OP_VALUE:
+					run_value_instruction( instruction, registers, block_count, spacing );
+					break;
+				case NOISE_OP_ABS:
+					for ( size_t i = 0; i < block_count; ++i )
+						dst[ i ] = k2 * fabsf( k0 * a[ i ] + k1 ) + k3;
+					break;
+				case NOISE_OP_LINEAR:
+					for ( size_t i = 0; i < block_count; ++i )
+						dst[ i ] = k0 * a[ i ] + k1 * b[ i ] + k2;
+					break;
+				case NOISE_OP_DETAIL:{
+					if ( get_octave_weight( instruction->cull_frequency, spacing ) == 0 ){
+						const float mean = k2 * program->tables[ instruction->table ].mean;
+						for ( size_t i = 0; i < block_count; ++i )
+							dst[ i ] = mean;
+						break;
+					}
+					const float correction = k1 + get_detail_correction( program, instruction, spacing );
+					if ( k0 == 1 && correction == 0 ) break;
+					for ( size_t i = 0; i < block_count; ++i )
+						dst[ i ] = k0 * a[ i ] + correction;
+					break;
+				}
+			}
+		}
+
+		memcpy( destination + block, registers[ program->result ], sizeof( float ) * block_count );
+	}
+}
+
+/// evaluation with gradients
+
+// every register carries its value and its partial derivatives along the input x and z
+struct noise_gradient_registers {
+	float value[ NOISE_PROGRAM_MAX_REGISTERS ][ NOISE_ROW_BLOCK ];
+	float dx[ NOISE_PROGRAM_MAX_REGISTERS ][ NOISE_ROW_BLOCK ];
+	float dz[ NOISE_PROGRAM_MAX_REGISTERS ][ NOISE_ROW_BLOCK ];
+};
+
+// the noise value and its derivatives along the noise's own coordinates, into the destination register
+static void store_value_gradient_sample( const struct noise_instruction *instruction, struct noise_gradient_registers *registers, size_t i, float value, float du, float dv )
+{
+	const int a = instruction->a, b = instruction->b, dst = instruction->dst;
+	const float scale = instruction->scale, k0 = instruction->k[ 0 ], k1 = instruction->k[ 1 ];
+
+	// chain rule through the ( possibly warped ) coordinate registers
+	du *= k0 * scale;
+	dv *= k0 * scale;
+	const float dx = du * registers->dx[ a ][ i ] + dv * registers->dx[ b ][ i ];
+	const float dz = du * registers->dz[ a ][ i ] + dv * registers->dz[ b ][ i ];
+
+	registers->value[ dst ][ i ] = ( k0 != 1 || k1 != 0 ) ? k0 * value + k1 : value;
+	registers->dx[ dst ][ i ] = dx;
+	registers->dz[ dst ][ i ] = dz;
+}
+
+static void run_value_gradient_sample( const struct noise_instruction *instruction, struct noise_gradient_registers *registers, size_t i, float skipped, int backend )
+{
+	const int a = instruction->a, b = instruction->b;
+	const float scale = instruction->scale;
+
+	float value, du, dv;
+	if ( backend == NOISE_BACKEND_SIMPLEX ){
+		value = psnoise2df_deriv( registers->value[ a ][ i ] * scale, registers->value[ b ][ i ] * scale, instruction->persistence, instruction->octaves, instruction->seed, skipped, &du, &dv );
+	}else if ( backend == NOISE_BACKEND_FAST ){
+		value = pnoise2df_deriv( registers->value[ a ][ i ] * scale, registers->value[ b ][ i ] * scale, instruction->persistence, instruction->octaves, instruction->seed, skipped, &du, &dv );
+	}else{
+		double value_d, du_d, dv_d;
+		value_d = pnoise2d_deriv( registers->value[ a ][ i ] * scale, registers->value[ b ][ i ] * scale, instruction->persistence, instruction->octaves, instruction->seed, skipped, &du_d, &dv_d );
+		value = value_d;
+		du = du_d;
+		dv = dv_d;
+	}
+
+	store_value_gradient_sample( instruction, registers, i, value, du, dv );
+}
+
+static void run_value_gradient_instruction( const struct noise_instruction *instruction, struct noise_gradient_registers *registers, size_t count, float spacing )
+{
+	const float skipped = get_value_skipped_octaves( instruction, spacing );
+	const int backend = get_instruction_backend( instruction );
+
+	// rows of the fast backend go through the SIMD kernels, bit-identical to the scalar derivatives
+	if ( backend == NOISE_BACKEND_FAST && instruction->uniform_b ){
+		const float scale = instruction->scale;
+		const float *x = registers->value[ instruction->a ];
+		float scaled_x[ NOISE_ROW_BLOCK ], values[ NOISE_ROW_BLOCK ], du[ NOISE_ROW_BLOCK ], dv[ NOISE_ROW_BLOCK ];
+		for ( size_t i = 0; i < count; ++i )
+			scaled_x[ i ] = x[ i ] * scale;
+
+		pnoise2df_deriv_row_simd_skip( scaled_x, registers->value[ instruction->b ][ 0 ] * scale, count, instruction->persistence, instruction->octaves, instruction->seed, skipped, values, du, dv );
+		for ( size_t i = 0; i < count; ++i )
+			store_value_gradient_sample( instruction, registers, i, values[ i ], du[ i ], dv[ i ] );
+		return;
+	}
+
+	for ( size_t i = 0; i < count; ++i )
+		run_value_gradient_sample( instruction, registers, i, skipped, backend );
+}
+
+/// field grids
+
+struct NoiseFieldGrid {
+	float x_origin, z_origin, spacing;
+	size_t samples, size;
+	atomic_size_t references;
+
+	// bound on the heights' distance to a full evaluation, and number of fields upsampled for them
+	float height_error;
+	size_t reused_fields;
+
+	// per field: offset of its value, dx and dz planes in data or -1 when not kept, and the bound on its raw noise error
+	int planes[ NOISE_PROGRAM_MAX_FIELDS ];
+	float errors[ NOISE_PROGRAM_MAX_FIELDS ];
+	float data[];
+};
+
+struct noise_grid_pass {
+	const NoiseFieldGrid *parent;
+	NoiseFieldGrid *fields;
+	boolval reused[ NOISE_PROGRAM_MAX_FIELDS ];
+
+	// parent sample under the grid's first one, and the first sample of the block being run
+	size_t offset_x, offset_z;
+	size_t row, column;
+};
+
+static boolval is_field_reused( const struct noise_grid_pass *pass, int field )
+{
+	return field >= 0 && pass->reused[ field ];
+}
+
+static boolval is_field_kept( const struct noise_grid_pass *pass, int field )
+{
+	return field >= 0 && pass->fields->planes[ field ] >= 0;
+}
+
+// the value noise lattice truncates towards zero, so an octave jumps across each of its negative lattice lines: no
+// interpolation bound holds over a parent cell straddling one. Simplex noise floors, and is continuous everywhere
+static boolval crosses_negative_lattice_line( const struct noise_instruction *instruction, float a, float b )
+{
+	if ( get_instruction_backend( instruction ) == NOISE_BACKEND_SIMPLEX ) return false;
+	for ( int o = 0; o < instruction->octaves; ++o ){
+		const float frequency = ldexpf( instruction->scale, -o );
+		if ( a * frequency < 0 && floorf( a * frequency ) != floorf( b * frequency ) ) return true;
+	}
+	return false;
+}
+
+// fills a value source's registers from the parent grid: samples on a parent sample are copied, the others averaged
+// from the two or four around them. Chunk borders are evaluated, so that they match the neighbouring chunks exactly:
+// the grid's own, and for a batch of four the seams between its chunks, which then come out as they would alone
+static void upsample_value_instruction( const struct noise_instruction *instruction, struct noise_gradient_registers *registers, size_t count, float spacing, const struct noise_grid_pass *pass )
+{
+	const NoiseFieldGrid *parent = pass->parent;
+	const size_t samples = parent->samples;
+	// a chunk has as many samples as its parent, a batch twice as many and a chunk under a batch's fields half as many
+	const size_t chunk_last = ( pass->fields->samples < samples ? pass->fields->samples : samples ) - 1;
+	const float *values = parent->data + parent->planes[ instruction->field ];
+	const float *dx = values + samples * samples, *dz = dx + samples * samples;
+	const float skipped = get_value_skipped_octaves( instruction, spacing );
+	const int backend = get_instruction_backend( instruction );
+	const int dst = instruction->dst;
+
+	// positions in half parent samples
+	const size_t half_z = 2 * pass->offset_z + pass->row;
+	const size_t z0 = half_z / 2, z1 = z0 + half_z % 2;
+	const boolval row_jumps = z0 != z1 && crosses_negative_lattice_line( instruction, parent->z_origin + z0 * parent->spacing, parent->z_origin + z1 * parent->spacing );
+
+	for ( size_t i = 0; i < count; ++i )
+	{
+		const size_t column = pass->column + i;
+		const size_t half_x = 2 * pass->offset_x + column;
+		const size_t x0 = half_x / 2, x1 = x0 + half_x % 2;
+
+		if ( pass->row % chunk_last == 0 || column % chunk_last == 0 || row_jumps
+			|| ( x0 != x1 && crosses_negative_lattice_line( instruction, parent->x_origin + x0 * parent->spacing, parent->x_origin + x1 * parent->spacing ) ) ){
+			run_value_gradient_sample( instruction, registers, i, skipped, backend );
+			continue;
+		}
+
+		const size_t c00 = z0 * samples + x0, c01 = z0 * samples + x1, c10 = z1 * samples + x0, c11 = z1 * samples + x1;
+		registers->value[ dst ][ i ] = 0.25f * ( values[ c00 ] + values[ c01 ] + values[ c10 ] + values[ c11 ] );
+		registers->dx[ dst ][ i ] = 0.25f * ( dx[ c00 ] + dx[ c01 ] + dx[ c10 ] + dx[ c11 ] );
+		registers->dz[ dst ][ i ] = 0.25f * ( dz[ c00 ] + dz[ c01 ] + dz[ c10 ] + dz[ c11 ] );
+	}
+}
+
+static void store_value_field( const struct noise_instruction *instruction, const struct noise_gradient_registers *registers, size_t count, const struct noise_grid_pass *pass )
+{
+	NoiseFieldGrid *fields = pass->fields;
+	const size_t plane_size = fields->samples * fields->samples;
+	float *values = fields->data + fields->planes[ instruction->field ] + pass->row * fields->samples + pass->column;
+	const int dst = instruction->dst;
+
+	for ( size_t i = 0; i < count; ++i ){
+		values[ i ] = registers->value[ dst ][ i ];
+		values[ plane_size + i ] = registers->dx[ dst ][ i ];
+		values[ 2 * plane_size + i ] = registers->dz[ dst ][ i ];
+	}
+}
+
+// runs the program over a block whose coordinate registers are set, pass is NULL outside of grids
+static void run_gradient_block( const NoiseProgram *program, struct noise_gradient_registers *registers, size_t block_count, float spacing, const struct noise_grid_pass *pass )
+{
+	for ( size_t n = 0; n < program->instruction_count; ++n )
+	{
+		const struct noise_instruction *instruction = &program->instructions[ n ];
+		if ( is_instruction_culled( instruction, spacing ) ) continue;
+
+		const int a = instruction->a, dst = instruction->dst;
+		const float k0 = instruction->k[ 0 ], k1 = instruction->k[ 1 ], k2 = instruction->k[ 2 ], k3 = instruction->k[ 3 ];
+
+		switch ( instruction->op )
+		{
+			case NOISE_OP_CONST:
+				for ( size_t i = 0; i < block_count; ++i ){
+					registers->value[ dst ][ i ] = k0;
+					registers->dx[ dst ][ i ] = 0;
+					registers->dz[ dst ][ i ] = 0;
+				}
+				break;
+			case NOISE_OP_VALUE:
+				if ( pass != NULL && is_field_reused( pass, instruction->field ) )
+					upsample_value_instruction( instruction, registers, block_count, spacing, pass );
+				else
+					run_value_gradient_instruction( instruction, registers, block_count, spacing );
+				if ( pass != NULL && is_field_kept( pass, instruction->field ) )
+					store_value_field( instruction, registers, block_count, pass );
+				break;
+			case NOISE_OP_ABS:
+				for ( size_t i = 0; i < block_count; ++i ){
+					const float inner = k0 * registers->value[ a ][ i ] + k1;
+					const float slope = inner < 0 ? -k2 * k0 : k2 * k0;
+					registers->value[ dst ][ i ] = k2 * fabsf( inner ) + k3;
+					registers->dx[ dst ][ i ] = slope * registers->dx[ a ][ i ];
+					registers->dz[ dst ][ i ] = slope * registers->dz[ a ][ i ];
+				}
+				break;
+			case NOISE_OP_LINEAR:{
+				const int b = instruction->b;
+				for ( size_t i = 0; i < block_count; ++i ){
+					registers->value[ dst ][ i ] = k0 * registers->value[ a ][ i ] + k1 * registers->value[ b ][ i ] + k2;
+					registers->dx[ dst ][ i ] = k0 * registers->dx[ a ][ i ] + k1 * registers->dx[ b ][ i ];
+					registers->dz[ dst ][ i ] = k0 * registers->dz[ a ][ i ] + k1 * registers->dz[ b ][ i ];
+				}
+				break;
+			}
+			case NOISE_OP_DETAIL:{
+				if ( get_octave_weight( instruction->cull_frequency, spacing ) == 0 ){
+					const float mean = k2 * program->tables[ instruction->table ].mean;
+					for ( size_t i = 0; i < block_count; ++i ){
+						registers->value[ dst ][ i ] = mean;
+						registers->dx[ dst ][ i ] = 0;
+						registers->dz[ dst ][ i ] = 0;
+					}
+					break;
+				}
+				const float correction = k1 + get_detail_correction( program, instruction, spacing );
+				if ( k0 == 1 && correction == 0 ) break;
+				for ( size_t i = 0; i < block_count; ++i ){
+					registers->value[ dst ][ i ] = k0 * registers->value[ a ][ i ] + correction;
+					registers->dx[ dst ][ i ] = k0 * registers->dx[ a ][ i ];
+					registers->dz[ dst ][ i ] = k0 * registers->dz[ a ][ i ];
+				}
+				break;
+			}
+		}
+	}
+}
+
+static void set_coordinate_registers( struct noise_gradient_registers *registers, const float *x, float z, size_t count )
+{
+	memcpy( registers->value[ NOISE_REGISTER_X ], x, sizeof( float ) * count );
+	for ( size_t i = 0; i < count; ++i ){
+		registers->value[ NOISE_REGISTER_Z ][ i ] = z;
+		registers->dx[ NOISE_REGISTER_X ][ i ] = 1;
+		registers->dz[ NOISE_REGISTER_X ][ i ] = 0;
+		registers->dx[ NOISE_REGISTER_Z ][ i ] = 0;
+		registers->dz[ NOISE_REGISTER_Z ][ i ] = 1;
+	}
+}
+
+void run_noise_program_row_gradient( const NoiseProgram *program, const float *x, float z, size_t count, float spacing, float *destination, float *dx, float *dz )
+{
+	struct noise_gradient_registers *registers = malloc( sizeof( struct noise_gradient_registers ) );
+
+	for ( size_t block = 0; block < count; block += NOISE_ROW_BLOCK )
+	{
+		const size_t block_count = ( count - block ) < NOISE_ROW_BLOCK ? ( count - block ) : NOISE_ROW_BLOCK;
+
+		set_coordinate_registers( registers, x + block, z, block_count );
+		run_gradient_block( program, registers, block_count, spacing, NULL );
+
+		memcpy( destination + block, registers->value[ program->result ], sizeof( float ) * block_count );
+		memcpy( dx + block, registers->dx[ program->result ], sizeof( float ) * block_count );
+		memcpy( dz + block, registers->dz[ program->result ], sizeof( float ) * block_count );
+	}
+
+	free( registers );
+}
+
+/// evaluation over grids
+
+// where a grid lies in its parent's: the parent has twice the spacing, and the grid covers a part of it starting on one
+// of its samples, one of its quarters for a child chunk or all of it for a batch of four
+static boolval locate_in_parent_grid( const NoiseFieldGrid *parent, float x_origin, float z_origin, float spacing, size_t samples, size_t *offset_x, size_t *offset_z )
+{
+	if ( parent == NULL || samples < 3 || ( samples - 1 ) % 2 != 0 ) return false;
+	if ( fabsf( parent->spacing - 2 * spacing ) > 1e-3f * spacing ) return false;
+
+	const float x = ( x_origin - parent->x_origin ) / parent->spacing, z = ( z_origin - parent->z_origin ) / parent->spacing;
+	const float rounded_x = roundf( x ), rounded_z = roundf( z ), last = ( float ) parent->samples - 1 - ( samples - 1 ) / 2;
+	if ( fabsf( x - rounded_x ) > 1e-3f || fabsf( z - rounded_z ) > 1e-3f ) return false;
+	if ( rounded_x < 0 || rounded_z < 0 || rounded_x > last || rounded_z > last ) return false;
+
+	*offset_x = rounded_x;
+	*offset_z = rounded_z;
+	return true;
+}
+
+NoiseFieldGrid *run_noise_program_grid( const NoiseProgram *program, float x_origin, float z_origin, float spacing, size_t samples, const NoiseFieldGrid *parent, float max_error, float *heights, float *gradients )
+{
+	struct noise_grid_pass pass;
+	memset( &pass, 0, sizeof( struct noise_grid_pass ) );
+	pass.parent = parent;
+
+	float errors[ NOISE_PROGRAM_MAX_FIELDS ] = { 0 };
+	float height_error = 0;
+	size_t reused_fields = 0;
+
+	if ( locate_in_parent_grid( parent, x_origin, z_origin, spacing, samples, &pass.offset_x, &pass.offset_z ) ){
+		// upsampling a field moves the heights by at most its sensitivity times its parent's error plus the interpolation
+		// bound over the parent's cells: take the cheapest fields first while the sum stays under max_error
+		const float parent_spacing_squared = parent->spacing * parent->spacing;
+		for ( ;; ){
+			const struct noise_instruction *cheapest = NULL;
+			float cheapest_cost = INFINITY;
+			for ( size_t n = 0; n < program->instruction_count; ++n ){
+				const struct noise_instruction *instruction = &program->instructions[ n ];
+				const int field = instruction->field;
+				if ( instruction->op != NOISE_OP_VALUE || field < 0 || pass.reused[ field ] || parent->planes[ field ] < 0 ) continue;
+				const float cost = instruction->sensitivity * ( parent->errors[ field ] + get_value_interpolation_error( instruction ) * parent_spacing_squared );
+				if ( cost < cheapest_cost ){
+					cheapest = instruction;
+					cheapest_cost = cost;
+				}
+			}
+			if ( cheapest == NULL || height_error + cheapest_cost > max_error ) break;
+
+			pass.reused[ cheapest->field ] = true;
+			errors[ cheapest->field ] = parent->errors[ cheapest->field ] + get_value_interpolation_error( cheapest ) * parent_spacing_squared;
+			height_error += cheapest_cost;
+			++reused_fields;
+		}
+	}
+
+	// keeps the fields evaluated at full detail here that the children could still afford to upsample
+	int planes[ NOISE_PROGRAM_MAX_FIELDS ];
+	size_t plane_count = 0;
+	for ( size_t f = 0; f < NOISE_PROGRAM_MAX_FIELDS; ++f )
+		planes[ f ] = -1;
+	for ( size_t n = 0; n < program->instruction_count; ++n ){
+		const struct noise_instruction *instruction = &program->instructions[ n ];
+		const int field = instruction->field;
+		if ( instruction->op != NOISE_OP_VALUE || field < 0 ) continue;
+		if ( is_instruction_culled( instruction, spacing ) || get_value_skipped_octaves( instruction, spacing ) != 0 ) continue;
+		if ( instruction->sensitivity * ( errors[ field ] + get_value_interpolation_error( instruction ) * spacing * spacing ) > max_error ) continue;
+		planes[ field ] = plane_count++ * 3 * samples * samples;
+	}
+
+	const size_t size = sizeof( NoiseFieldGrid ) + sizeof( float ) * plane_count * 3 * samples * samples;
+	NoiseFieldGrid *fields = malloc( size );
+	fields->x_origin = x_origin;
+	fields->z_origin = z_origin;
+	fields->spacing = spacing;
+	fields->samples = samples;
+	fields->size = size;
+	atomic_init( &fields->references, 1 );
+	fields->height_error = height_error;
+	fields->reused_fields = reused_fields;
+	memcpy( fields->planes, planes, sizeof( planes ) );
+	memcpy( fields->errors, errors, sizeof( errors ) );
+	pass.fields = fields;
+
+	struct noise_gradient_registers *registers = malloc( sizeof( struct noise_gradient_registers ) );
+	float x[ NOISE_ROW_BLOCK ];
+
+	for ( size_t row = 0; row < samples; ++row )
+	{
+		for ( size_t block = 0; block < samples; block += NOISE_ROW_BLOCK )
+		{
+			const size_t block_count = ( samples - block ) < NOISE_ROW_BLOCK ? ( samples - block ) : NOISE_ROW_BLOCK;
+			for ( size_t i = 0; i < block_count; ++i )
+				x[ i ] = x_origin + ( block + i ) * spacing;
+
+			set_coordinate_registers( registers, x, z_origin + row * spacing, block_count );
+			pass.row = row;
+			pass.column = block;
+			run_gradient_block( program, registers, block_count, spacing, &pass );
+
+			for ( size_t i = 0; i < block_count; ++i ){
+				const size_t index = row * samples + block + i;
+				heights[ index ] = registers->value[ program->result ][ i ];
+				gradients[ 2 * index + 0 ] = registers->dx[ program->result ][ i ];
+				gradients[ 2 * index + 1 ] = registers->dz[ program->result ][ i ];
+			}
+		}
+	}
+
+	free( registers );
+	return fields;
+}
+
+NoiseFieldGrid *retain_noise_field_grid( NoiseFieldGrid *fields )
+{
+	if ( fields == NULL ) return NULL;
+	atomic_fetch_add_explicit( &fields->references, 1, memory_order_relaxed );
+	return fields;
+}
+
+NoiseFieldGrid *slice_noise_field_grid( const NoiseFieldGrid *fields, size_t offset_x, size_t offset_z, size_t samples )
+{
+	if ( fields == NULL ) return NULL;
+
+	size_t plane_count = 0;
+	for ( size_t f = 0; f < NOISE_PROGRAM_MAX_FIELDS; ++f )
+		if ( fields->planes[ f ] >= 0 ) ++plane_count;
+
+	const size_t size = sizeof( NoiseFieldGrid ) + sizeof( float ) * plane_count * 3 * samples * samples;
+	NoiseFieldGrid *slice = malloc( size );
+	memcpy( slice, fields, sizeof( NoiseFieldGrid ) );
+	slice->x_origin = fields->x_origin + offset_x * fields->spacing;
+	slice->z_origin = fields->z_origin + offset_z * fields->spacing;
+	slice->samples = samples;
+	slice->size = size;
+	atomic_init( &slice->references, 1 );
+
+	// same planes in the same order, each cropped
+	size_t plane = 0;
+	for ( size_t f = 0; f < NOISE_PROGRAM_MAX_FIELDS; ++f ){
+		if ( fields->planes[ f ] < 0 ) continue;
+		slice->planes[ f ] = plane++ * 3 * samples * samples;
+		for ( size_t component = 0; component < 3; ++component ){
+			const float *source = fields->data + fields->planes[ f ] + component * fields->samples * fields->samples;
+			float *destination = slice->data + slice->planes[ f ] + component * samples * samples;
+			for ( size_t z = 0; z < samples; ++z )
+				memcpy( destination + z * samples, source + ( offset_z + z ) * fields->samples + offset_x, sizeof( float ) * samples );
+		}
+	}
+
+	return slice;
+}
+
+void delete_noise_field_grid( NoiseFieldGrid *fields )
+{
+	if ( fields == NULL ) return;
+	if ( atomic_fetch_sub_explicit( &fields->references, 1, memory_order_acq_rel ) == 1 )
+		free( fields );
+}
+
+float get_noise_field_grid_height_error( const NoiseFieldGrid *fields )
+{
+	return fields->height_error;
+}
+
+size_t get_noise_field_grid_reused_fields( const NoiseFieldGrid *fields )
+{
+	return fields->reused_fields;
+}
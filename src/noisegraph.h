@@ -0,0 +1,77 @@
+#ifndef _NOISEGRAPH_H_
+#define _NOISEGRAPH_H_
+
+#include <stddef.h>
+
+// Noise graphs describe a terrain height function as a list of named nodes, one per line:
+//
+//	# comment
+//	name = type [input names...] [key=value...]
+//
+// Node types, inputs must be defined on an earlier line:
+//	constant value=v                                   v
+//	value seed=s octaves=4 persistence=1 backend=b     pnoise2d value noise, backend is default, reference or fast,
+//	                                                   or simplex for gradient noise (psnoise2df) instead
+//	frequency in factor=f                              in evaluated at coordinates * f
+//	octaves in count=n lacunarity=2 gain=0.5           sum of in evaluated at coordinates * lacunarity^k, weighted gain^k
+//	ridge in offset=0.5                                1 - 2 * |in - offset|
+//	abs in                                             |in|
+//	scale in factor=f                                  in * f
+//	bias in value=v                                    in + v
+//	add a b                                            a + b
+//	warp in dx [dz] amount=a                           in evaluated at coordinates displaced by a * dx (and a * dz)
+//
+// The node named "output" (or the last one) is the height. Compilation flattens the graph into a straight list of
+// row-wide instructions: octave stacks are unrolled, scales and biases are folded into the instructions producing
+// them, constant subtrees are evaluated once, and nodes unreachable from the output or weighted by 0 are dropped.
+//
+// Programs run at a sample spacing. Value sources leave out their inner octaves as those get close to one lattice cell
+// per sample (faded between NOISE_OCTAVE_FADE_START and _END cells per sample, see config.h); each octave of an octaves
+// node fades to its expected value, and stops being evaluated, once the coarsest inner octave of its sources does too.
+// A spacing of 0 evaluates everything.
+//
+// Grids can reuse their parent grid's value sources: a chunk keeps the value sources it evaluated at full detail as
+// fields, and its children (half the spacing, over a quarter of it, or all four at once over all of it) upsample the low
+// frequency ones instead of evaluating them. Fields are taken cheapest first while the bound on the height error they add stays under the given maximum:
+// bilinear interpolation of value noise is off by at most h^2 / 8 times its second derivative bound, scaled by how much
+// the output can move per unit of the field (ridges double it), plus the parent field's own error. Value sources inside
+// warps are always evaluated. Grid borders are always evaluated, so neighbouring chunks keep matching exactly.
+
+#define NOISE_PROGRAM_MAX_REGISTERS 32
+#define NOISE_PROGRAM_MAX_FIELDS 16
+
+typedef struct NoiseProgram NoiseProgram;
+typedef struct NoiseFieldGrid NoiseFieldGrid;
+
+// returns NULL and prints the reason on failure
+NoiseProgram *compile_noise_graph( const char *source );
+void delete_noise_program( NoiseProgram *program );
+
+size_t get_noise_program_instruction_count( const NoiseProgram *program );
+
+// largest sample spacing at which no octave is faded yet, INFINITY if the program has no octaves
+float get_noise_program_full_detail_spacing( const NoiseProgram *program );
+
+// destination[i] = height at ( x[i], z )
+void run_noise_program_row( const NoiseProgram *program, const float *x, float z, size_t count, float spacing, float *destination );
+
+// same heights, plus their analytic partial derivatives along x and z propagated through every node (chain rule)
+void run_noise_program_row_gradient( const NoiseProgram *program, const float *x, float z, size_t count, float spacing, float *destination, float *dx, float *dz );
+
+// heights and interleaved ( dh/dx, dh/dz ) over a samples x samples row-major grid at the origin plus multiples of
+// spacing, upsampling what parent (NULL for none) allows within max_error. Returns the grid's own fields, for its children
+NoiseFieldGrid *run_noise_program_grid( const NoiseProgram *program, float x_origin, float z_origin, float spacing, size_t samples, const NoiseFieldGrid *parent, float max_error, float *heights, float *gradients );
+
+// field grids are never written once made, so holders share them: retain takes one more reference to the same grid,
+// from any thread, and delete drops one, freeing the grid with the last
+NoiseFieldGrid *retain_noise_field_grid( NoiseFieldGrid *fields );
+
+// the fields over a samples x samples part of the grid, from sample ( offset_x, offset_z ): one chunk's out of a batch's
+NoiseFieldGrid *slice_noise_field_grid( const NoiseFieldGrid *fields, size_t offset_x, size_t offset_z, size_t samples );
+void delete_noise_field_grid( NoiseFieldGrid *fields );
+
+// bound on how far the grid's heights are from a full evaluation, and how many fields were upsampled for it
+float get_noise_field_grid_height_error( const NoiseFieldGrid *fields );
+size_t get_noise_field_grid_reused_fields( const NoiseFieldGrid *fields );
+
+#endif
@@ -1,8 +1,55 @@
 #include "noises.h"
 
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
 #include <math.h>
 
 #include "./../libs/perlin/perlin.h"
+#include "config.h"
+#include "noisegraph.h"
+
+static enum NoiseBackend g_noise_backend = DEFAULT_NOISE_BACKEND;
+
+// same terrain as the hand-written ridged multifractal, used when no recipe is loaded
+static const char *g_builtin_terrain_recipe =
+	"base = value seed=415646549 octaves=4 persistence=1\n"
+	"ridged = ridge base offset=0.5\n"
+	"terrain = octaves ridged count=6 lacunarity=2 gain=0.5\n"
+	"mapped = frequency terrain factor=0.00048828125\n"
+	"output = scale mapped factor=128\n";
+
+static NoiseProgram *g_terrain_program = NULL;
+
+void set_noise_backend(enum NoiseBackend backend)
+{
+	if ( backend == NOISE_BACKEND_SIMPLEX ){
+		fprintf( stderr, "The simplex backend is selected per value node, keeping the current backend\n" );
+		return;
+	}
+	g_noise_backend = backend;
+}
+
+enum NoiseBackend get_noise_backend()
+{
+	return g_noise_backend;
+}
+
+boolval set_terrain_recipe(const char *source)
+{
+	NoiseProgram *program = compile_noise_graph( source ? source : g_builtin_terrain_recipe );
+	if ( program == NULL ) return false;
+
+	if ( g_terrain_program ) delete_noise_program( g_terrain_program );
+	g_terrain_program = program;
+	return true;
+}
+
+// set_terrain_recipe installs it before any thread samples the terrain, never compiled from here
+static const NoiseProgram *get_terrain_program()
+{
+	return g_terrain_program;
+}
 
 float perlin_noise2D(float x, float y, int seed, int octaves)
 {
@@ -21,6 +68,9 @@ float perlin_noise2D(float x, float y, int seed, int octaves)
 
 float ridged_noise2D(float x, float y, int seed)
 {
+	if (g_noise_backend == NOISE_BACKEND_FAST)
+		return 1.0f - fabsf( pnoise2df(x, y, 1, 4, seed) - 0.5f )*2;
+
 	float val = pnoise2d(x, y, 1, 4, seed);
 	float res = 1.0 - fabs( val - 0.5 )*2;
 	return res;
@@ -43,14 +93,131 @@ float ridged_multifractal_noise2D(float x, float y, int seed, int octaves)
 
 float terrain_heightmap_func(float x, float y)
 {
-	const float scale = 16;
-	const double plane_mapping_factor = 0.0625/scale;
-	const float amplitude = 4*scale;
+	float result;
+	run_noise_program_row( get_terrain_program(), &x, y, 1, 0, &result );
+	return result;
+}
+
+/// batched evaluation
+
+void ridged_multifractal_noise2D_row(const float *x, float y, size_t count, int seed, int octaves, float *destination)
+{
+	double scaled_x[ NOISE_ROW_BLOCK ], values[ NOISE_ROW_BLOCK ];
+	float scaled_xf[ NOISE_ROW_BLOCK ], valuesf[ NOISE_ROW_BLOCK ];
+	const boolval fast = g_noise_backend == NOISE_BACKEND_FAST;
 
-	float result = 0; //amplitude*pnoise2d(x*plane_mapping_factor, y*plane_mapping_factor, 1, 1, 45645656);
-	//result += 1000*pow( pnoise2d( x*plane_mapping_factor*(1.0/10.0), y*plane_mapping_factor*(1.0/10.0), 1, 1, 45465 ), 4 );
-	result += 128*ridged_multifractal_noise2D(x*(1.0/(128.0*16.0) ), y*(1.0/(128.0*16.0)), 415646549, 6);
-	//result -= 300;
+	for ( size_t block = 0; block < count; block += NOISE_ROW_BLOCK ){
+		const size_t block_count = ( count - block ) < NOISE_ROW_BLOCK ? ( count - block ) : NOISE_ROW_BLOCK;
+		const float *block_x = x + block;
+		float *block_destination = destination + block;
 
-	return result;
+		for ( size_t i = 0; i < block_count; ++i )
+			block_destination[ i ] = 0;
+
+		float amplitude = 1, coordsScaleFactor = 1;
+
+		for ( size_t o = 0; o < octaves; ++o ){
+			if ( fast ){
+				for ( size_t i = 0; i < block_count; ++i )
+					scaled_xf[ i ] = block_x[ i ] * coordsScaleFactor;
+
+				pnoise2df_row_simd( scaled_xf, y * coordsScaleFactor, block_count, 1, 4, seed, valuesf );
+
+				for ( size_t i = 0; i < block_count; ++i )
+					block_destination[ i ] += amplitude*( 1.0f - fabsf( valuesf[ i ] - 0.5f )*2 );
+			}else{
+				for ( size_t i = 0; i < block_count; ++i )
+					scaled_x[ i ] = block_x[ i ] * coordsScaleFactor;
+
+				pnoise2d_row( scaled_x, y * coordsScaleFactor, block_count, 1, 4, seed, values );
+
+				for ( size_t i = 0; i < block_count; ++i ){
+					float val = values[ i ];
+					float res = 1.0 - fabs( val - 0.5 )*2;
+					block_destination[ i ] += amplitude*res;
+				}
+			}
+
+			amplitude /= 2.0;
+			coordsScaleFactor *= 2.0;
+		}
+	}
+}
+
+void terrain_heightmap_row(const float *x, float y, size_t count, float spacing, float *destination)
+{
+	run_noise_program_row( get_terrain_program(), x, y, count, spacing, destination );
+}
+
+void terrain_heightmap_row_gradient(const float *x, float y, size_t count, float spacing, float *destination, float *dx, float *dz)
+{
+	run_noise_program_row_gradient( get_terrain_program(), x, y, count, spacing, destination, dx, dz );
+}
+
+float get_terrain_full_detail_spacing()
+{
+	return get_noise_program_full_detail_spacing( get_terrain_program() );
+}
+
+void terrain_heightmap_grid(float x_origin, float z_origin, float spacing, size_t samples, float *destination, float *gradients)
+{
+	float *x = malloc( sizeof( float ) * samples );
+	for ( size_t i = 0; i < samples; ++i )
+		x[ i ] = x_origin + i*spacing;
+
+	float *dx = NULL, *dz = NULL;
+	if ( gradients != NULL ){
+		dx = malloc( sizeof( float ) * samples * 2 );
+		dz = dx + samples;
+	}
+
+	for ( size_t z = 0; z < samples; ++z ){
+		if ( gradients == NULL ){
+			terrain_heightmap_row( x, z_origin + z*spacing, samples, spacing, destination + z*samples );
+			continue;
+		}
+
+		terrain_heightmap_row_gradient( x, z_origin + z*spacing, samples, spacing, destination + z*samples, dx, dz );
+		for ( size_t i = 0; i < samples; ++i ){
+			gradients[ 2*( z*samples + i ) + 0 ] = dx[ i ];
+			gradients[ 2*( z*samples + i ) + 1 ] = dz[ i ];
+		}
+	}
+
+	free( dx );
+	free( x );
+}
+
+NoiseFieldGrid *terrain_heightmap_grid_hierarchical(float x_origin, float z_origin, float spacing, size_t samples, const NoiseFieldGrid *parent, float *destination, float *gradients)
+{
+	return run_noise_program_grid( get_terrain_program(), x_origin, z_origin, spacing, samples, parent, HIERARCHICAL_SYNTHESIS_MAX_ERROR, destination, gradients );
+}
+
+/// backend comparison
+
+void measure_noise_backend_deviation(enum NoiseBackend backend, float x_origin, float z_origin, float spacing, size_t samples, float *max_deviation, float *mean_deviation)
+{
+	const enum NoiseBackend previous_backend = g_noise_backend;
+	float *reference = malloc( sizeof( float ) * samples * samples );
+	float *measured = malloc( sizeof( float ) * samples * samples );
+
+	g_noise_backend = NOISE_BACKEND_REFERENCE;
+	terrain_heightmap_grid( x_origin, z_origin, spacing, samples, reference, NULL );
+	g_noise_backend = backend;
+	terrain_heightmap_grid( x_origin, z_origin, spacing, samples, measured, NULL );
+	g_noise_backend = previous_backend;
+
+	double sum = 0;
+	float max = 0;
+	for ( size_t i = 0; i < samples * samples; ++i ){
+		float deviation = fabsf( measured[ i ] - reference[ i ] );
+		sum += deviation;
+		if ( deviation > max ) max = deviation;
+	}
+
+	*max_deviation = max;
+	*mean_deviation = sum / ( double ) ( samples * samples );
+
+	free( reference );
+	free( measured );
 }
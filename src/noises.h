@@ -1,9 +1,64 @@
 #ifndef NOISES_HEADERGUARD
 #define NOISES_HEADERGUARD
 
+#include <stddef.h>
+
+#include "boolvals.h"
+#include "noisegraph.h"
+
+// max samples a row kernel processes at once, bounds its stack scratch
+#define NOISE_ROW_BLOCK 64
+
+// value noise implementations the terrain functions can run on.
+// NOISE_BACKEND_REFERENCE is the double precision, cosine-interpolated perlin.c path.
+// NOISE_BACKEND_FAST is float-only with a quintic fade over the same lattice; it stays within
+// NOISE_FAST_MAX_DEVIATION height units of the reference terrain (measured max ~0.15, mean ~0.03).
+// NOISE_BACKEND_SIMPLEX is a different noise, simplex gradient noise (simplex.c), not another implementation of the
+// same one: recipes pick it per value node (backend=simplex), the global backend stays reference or fast.
+enum NoiseBackend {
+	NOISE_BACKEND_REFERENCE,
+	NOISE_BACKEND_FAST,
+	NOISE_BACKEND_SIMPLEX
+};
+
+#define NOISE_FAST_MAX_DEVIATION 0.5f
+
+// the backend is global, select it before the generator threads start
+void set_noise_backend(enum NoiseBackend backend);
+enum NoiseBackend get_noise_backend();
+
+// compiles a noise graph recipe (see noisegraph.h) into the terrain height function, NULL restores the builtin
+// ridged multifractal. On failure the previous recipe stays active. Call it before the generator threads start: the
+// terrain functions sample whichever recipe was set last, and none is until then.
+boolval set_terrain_recipe(const char *source);
+
 float perlin_noise2D(float x, float y, int seed, int octaves);
 float ridged_noise2D(float x, float y, int seed);
 float ridged_multifractal_noise2D(float x, float y, int seed, int octaves);
 float terrain_heightmap_func(float x, float y);
 
+// batched variants, results match the per-point functions sample for sample
+void ridged_multifractal_noise2D_row(const float *x, float y, size_t count, int seed, int octaves, float *destination);
+
+// the terrain sampled every spacing units: octaves too fine for that rate fade out (see noisegraph.h), spacing 0 keeps
+// them all and matches terrain_heightmap_func
+void terrain_heightmap_row(const float *x, float y, size_t count, float spacing, float *destination);
+
+// heights plus their analytic partial derivatives along x and z
+void terrain_heightmap_row_gradient(const float *x, float y, size_t count, float spacing, float *destination, float *dx, float *dz);
+
+// largest spacing the terrain is still sampled at full detail with
+float get_terrain_full_detail_spacing();
+
+// fills a samples x samples row-major grid (rows along z) starting at the given origin, at the grid's spacing.
+// gradients, when not NULL, receives ( dh/dx, dh/dz ) for every sample, interleaved in the same order
+void terrain_heightmap_grid(float x_origin, float z_origin, float spacing, size_t samples, float *destination, float *gradients);
+
+// same grid with gradients, upsampling the low frequency value sources of the parent chunk's fields (NULL for none)
+// within HIERARCHICAL_SYNTHESIS_MAX_ERROR height units, see noisegraph.h. Returns the fields its children can reuse
+NoiseFieldGrid *terrain_heightmap_grid_hierarchical(float x_origin, float z_origin, float spacing, size_t samples, const NoiseFieldGrid *parent, float *destination, float *gradients);
+
+// samples the terrain with a backend and with the reference path over the same grid, and reports the height deviation
+void measure_noise_backend_deviation(enum NoiseBackend backend, float x_origin, float z_origin, float spacing, size_t samples, float *max_deviation, float *mean_deviation);
+
 #endif
@@ -54,14 +54,21 @@ void drawPerspectiveObject(PerspectiveObject* obj)
 		glBindBuffer(GL_ARRAY_BUFFER, obj->meshVBO);
 
 		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+		glVertexAttribPointer(0, obj->gridMesh ? 1 : 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+		if (obj->gridMorph){
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 0, (void*)(obj->vertices*sizeof(float)));
+		}else glDisableVertexAttribArray(3);
 	}
 
 	if (obj->normalsInitialized){
 		glBindBuffer(GL_ARRAY_BUFFER, obj->normalsVBO);
 
 		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+		if (obj->gridMesh)
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, 0, 0);
+		else glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
 	}
 
 	if (obj->UVsInitialized){
@@ -90,6 +97,13 @@ void drawPerspectiveObject(PerspectiveObject* obj)
 		glUniformMatrix4fv(glGetUniformLocation(drawProgram, "modelMatrix"), 1, GL_FALSE, modelMatrix[0]);
 	}
 
+	//Grid mesh layout
+	if (obj->gridMesh){
+		glUniform1f(glGetUniformLocation(drawProgram, "gridSpacing"), obj->gridSpacing);
+		glUniform1i(glGetUniformLocation(drawProgram, "gridSideVertices"), obj->gridSideVertices);
+		glUniform2f(glGetUniformLocation(drawProgram, "morphRange"), obj->gridMorph ? obj->morphStart : 0, obj->gridMorph ? obj->morphEnd : 0);
+	}
+
 	//Light data fetch
 	if (obj->material->fetchLightData){
 		glUniform3fv(glGetUniformLocation(drawProgram, "ambientLightColor"), 1, &g_ambientLightColor[0]);
@@ -145,7 +159,12 @@ void drawPerspectiveObject(PerspectiveObject* obj)
 		glUniform1i(glGetUniformLocation(drawProgram, uniformName), data->textureIndex);
 	}
 
-	glDrawArrays(GL_TRIANGLES, 0, obj->vertices);
+	if (obj->IBOInitialized){
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj->IBO);
+		glDrawElements(GL_TRIANGLES, obj->indices, GL_UNSIGNED_INT, 0);
+	}else{
+		glDrawArrays(GL_TRIANGLES, 0, obj->vertices);
+	}
 }
 
 void setObjectVBO(PerspectiveObject* objPtr, GLuint vboHandle, enum BufferType type)
@@ -159,6 +178,10 @@ void setObjectVBO(PerspectiveObject* objPtr, GLuint vboHandle, enum BufferType t
 			objPtr->normalsVBO = vboHandle;
 			objPtr->normalsInitialized = true;
 		break;
+		case INDICES:
+			objPtr->IBO = vboHandle;
+			objPtr->IBOInitialized = true;
+		break;
 		default:
 			objPtr->UVsVBO = vboHandle;
 			objPtr->UVsInitialized = true;
@@ -190,10 +213,15 @@ PerspectiveObject* createPerspectiveObject( )
 	obj->eulerAnglesRotation = zero;
 
 	obj->vertices = 0;
+	obj->indices = 0;
 
 	obj->meshInitialized = false;
 	obj->normalsInitialized = false;
 	obj->UVsInitialized = false;
+	obj->IBOInitialized = false;
+
+	obj->gridMesh = false;
+	obj->gridMorph = false;
 
 	PerspectiveObject** data = pushDataInDynamicArray( g_workspace, &obj );
 	return *data;
@@ -9,15 +9,27 @@
 enum BufferType {
 	VERTICES,
 	NORMALS,
-	UVS
+	UVS,
+	INDICES
 };
 
 typedef struct PerspectiveObject {
 	Vec3fl position, eulerAnglesRotation;
 
-	GLuint meshVBO, normalsVBO, UVsVBO;
-	size_t vertices;
-	boolval meshInitialized, normalsInitialized, UVsInitialized;
+	GLuint meshVBO, normalsVBO, UVsVBO, IBO;
+	size_t vertices, indices; // indices, when the object has an IBO, are drawn instead of the vertices in order
+	boolval meshInitialized, normalsInitialized, UVsInitialized, IBOInitialized;
+
+	// grid meshes hold one height and one octahedral normal (two shorts) per vertex, laid out on a gridSideVertices wide
+	// grid with gridSpacing between vertices
+	boolval gridMesh;
+	float gridSpacing;
+	int gridSideVertices;
+
+	// morphing grid meshes also hold, after their heights, the heights they blend into between morphStart and morphEnd
+	// away from the camera
+	boolval gridMorph;
+	float morphStart, morphEnd;
 
 	Material* material;
 	boolval useDepth, visible;
@@ -0,0 +1,108 @@
+#include "parallel.h"
+
+#include <pthread.h>
+
+/// definitions
+
+struct parallel_loop {
+	void ( *body )( void *data, size_t index );
+	void *data;
+	size_t count, next, finished;
+};
+
+static struct parallel_loop *g_loop = NULL;
+static size_t g_helpers = 0;
+static void ( *g_wakeup )() = NULL;
+static pthread_mutex_t g_loop_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_loop_finished = PTHREAD_COND_INITIALIZER;
+
+/// static utils
+
+// takes iterations one at a time under the lock, the body itself runs unlocked
+static boolval run_loop_iterations( struct parallel_loop *loop )
+{
+	boolval ran = false;
+
+	pthread_mutex_lock( &g_loop_mtx );
+	while ( g_loop == loop && loop->next < loop->count ){
+		size_t index = loop->next++;
+		pthread_mutex_unlock( &g_loop_mtx );
+
+		loop->body( loop->data, index );
+		ran = true;
+
+		pthread_mutex_lock( &g_loop_mtx );
+		if ( ++loop->finished == loop->count )
+			pthread_cond_broadcast( &g_loop_finished );
+	}
+	pthread_mutex_unlock( &g_loop_mtx );
+
+	return ran;
+}
+
+/// interface
+
+void set_parallel_loop_helpers( size_t helpers )
+{
+	pthread_mutex_lock( &g_loop_mtx );
+	g_helpers = helpers;
+	pthread_mutex_unlock( &g_loop_mtx );
+}
+
+void set_parallel_loop_wakeup( void ( *wakeup )() )
+{
+	pthread_mutex_lock( &g_loop_mtx );
+	g_wakeup = wakeup;
+	pthread_mutex_unlock( &g_loop_mtx );
+}
+
+void run_parallel_for( void ( *body )( void *data, size_t index ), void *data, size_t count )
+{
+	struct parallel_loop loop = { body, data, count, 0, 0 };
+
+	pthread_mutex_lock( &g_loop_mtx );
+	boolval serial = g_helpers == 0 || g_loop != NULL || count < 2;
+	if ( !serial )
+		g_loop = &loop;
+	void ( *wakeup )() = g_wakeup;
+	pthread_mutex_unlock( &g_loop_mtx );
+
+	if ( serial ){
+		for ( size_t i = 0; i < count; ++i )
+			body( data, i );
+		return;
+	}
+
+	if ( wakeup != NULL )
+		wakeup();
+
+	run_loop_iterations( &loop );
+
+	// helpers may still be running the last iterations they took
+	pthread_mutex_lock( &g_loop_mtx );
+	while ( loop.finished < loop.count )
+		pthread_cond_wait( &g_loop_finished, &g_loop_mtx );
+	g_loop = NULL;
+	pthread_mutex_unlock( &g_loop_mtx );
+}
+
+boolval is_parallel_loop_posted()
+{
+	pthread_mutex_lock( &g_loop_mtx );
+	boolval posted = g_loop != NULL && g_loop->next < g_loop->count;
+	pthread_mutex_unlock( &g_loop_mtx );
+
+	return posted;
+}
+
+boolval help_parallel_loop()
+{
+	pthread_mutex_lock( &g_loop_mtx );
+	struct parallel_loop *loop = g_loop;
+	pthread_mutex_unlock( &g_loop_mtx );
+
+	if ( loop == NULL )
+		return false;
+
+	return run_loop_iterations( loop );
+}
@@ -0,0 +1,27 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <stddef.h>
+
+#include "boolvals.h"
+
+// Parallel loops run on the generator threads: one loop at a time is posted, and idle workers take its iterations
+// (see help_parallel_loop) alongside the caller, which returns once every iteration is done. Without helper threads,
+// or while another loop is running, the loop runs serially on the caller.
+
+// number of threads calling help_parallel_loop, 0 runs every loop serially
+void set_parallel_loop_helpers( size_t helpers );
+
+// called, without any lock held, each time a loop is posted: helpers sleeping on their own work queue wake up through it
+void set_parallel_loop_wakeup( void ( *wakeup )() );
+
+// calls body( data, i ) for i in [ 0, count ), in any order and on any thread
+void run_parallel_for( void ( *body )( void *data, size_t index ), void *data, size_t count );
+
+// runs iterations of the posted loop until none are left, returns false if there was nothing to do
+boolval help_parallel_loop();
+
+// true while a loop has iterations left to take
+boolval is_parallel_loop_posted();
+
+#endif
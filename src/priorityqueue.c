@@ -0,0 +1,142 @@
+#include "priorityqueue.h"
+
+#include <stdlib.h>
+
+/// definitions
+
+struct PriorityQueue {
+	size_t capacity, length;
+	int *heap; // items, heap ordered
+	float *priorities; // per item
+	size_t *positions; // per item, capacity when not queued
+};
+
+/// static utils
+
+static void place_item( PriorityQueue *queue, size_t position, int item )
+{
+	queue->heap[ position ] = item;
+	queue->positions[ item ] = position;
+}
+
+static void sift_up( PriorityQueue *queue, size_t position )
+{
+	const int item = queue->heap[ position ];
+	const float priority = queue->priorities[ item ];
+
+	while ( position > 0 ){
+		const size_t parent = ( position - 1 ) / 2;
+		if ( queue->priorities[ queue->heap[ parent ] ] >= priority ) break;
+		place_item( queue, position, queue->heap[ parent ] );
+		position = parent;
+	}
+	place_item( queue, position, item );
+}
+
+static void sift_down( PriorityQueue *queue, size_t position )
+{
+	const int item = queue->heap[ position ];
+	const float priority = queue->priorities[ item ];
+
+	while ( true ){
+		size_t child = position * 2 + 1;
+		if ( child >= queue->length ) break;
+		if ( child + 1 < queue->length && queue->priorities[ queue->heap[ child + 1 ] ] > queue->priorities[ queue->heap[ child ] ] ) ++child;
+		if ( queue->priorities[ queue->heap[ child ] ] <= priority ) break;
+		place_item( queue, position, queue->heap[ child ] );
+		position = child;
+	}
+	place_item( queue, position, item );
+}
+
+/// interface
+
+PriorityQueue *create_priority_queue( size_t capacity )
+{
+	PriorityQueue *queue = malloc( sizeof( PriorityQueue ) );
+	queue->capacity = capacity;
+	queue->length = 0;
+	queue->heap = malloc( sizeof( int ) * capacity );
+	queue->priorities = malloc( sizeof( float ) * capacity );
+	queue->positions = malloc( sizeof( size_t ) * capacity );
+	for ( size_t i = 0; i < capacity; ++i )
+		queue->positions[ i ] = capacity;
+
+	return queue;
+}
+
+void delete_priority_queue( PriorityQueue *queue )
+{
+	if ( queue == NULL ) return;
+	free( queue->heap );
+	free( queue->priorities );
+	free( queue->positions );
+	free( queue );
+}
+
+size_t get_priority_queue_length( const PriorityQueue *queue )
+{
+	return queue->length;
+}
+
+boolval is_priority_queue_item_queued( const PriorityQueue *queue, int item )
+{
+	return queue->positions[ item ] != queue->capacity;
+}
+
+int get_priority_queue_item( const PriorityQueue *queue, size_t position )
+{
+	return queue->heap[ position ];
+}
+
+void push_priority_queue( PriorityQueue *queue, int item, float priority )
+{
+	if ( is_priority_queue_item_queued( queue, item ) ){
+		const float previous = queue->priorities[ item ];
+		queue->priorities[ item ] = priority;
+		if ( priority > previous )
+			sift_up( queue, queue->positions[ item ] );
+		else
+			sift_down( queue, queue->positions[ item ] );
+		return;
+	}
+
+	queue->priorities[ item ] = priority;
+	place_item( queue, queue->length++, item );
+	sift_up( queue, queue->length - 1 );
+}
+
+int pop_priority_queue( PriorityQueue *queue )
+{
+	if ( queue->length == 0 ) return -1;
+
+	const int item = queue->heap[ 0 ];
+	remove_priority_queue( queue, item );
+	return item;
+}
+
+boolval remove_priority_queue( PriorityQueue *queue, int item )
+{
+	if ( !is_priority_queue_item_queued( queue, item ) ) return false;
+
+	const size_t position = queue->positions[ item ];
+	queue->positions[ item ] = queue->capacity;
+
+	// the last item fills the hole, and moves whichever way its priority takes it
+	const int last = queue->heap[ --queue->length ];
+	if ( last != item ){
+		place_item( queue, position, last );
+		sift_up( queue, position );
+		sift_down( queue, queue->positions[ last ] );
+	}
+	return true;
+}
+
+void reprioritize_priority_queue( PriorityQueue *queue, float ( *priority )( int item, void *data ), void *data )
+{
+	for ( size_t i = 0; i < queue->length; ++i )
+		queue->priorities[ queue->heap[ i ] ] = priority( queue->heap[ i ], data );
+
+	for ( size_t i = queue->length / 2; i-- > 0; )
+		sift_down( queue, i );
+}
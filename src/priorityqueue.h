@@ -0,0 +1,35 @@
+#ifndef _PRIORITYQUEUE_H_
+#define _PRIORITYQUEUE_H_
+
+#include <stddef.h>
+
+#include "boolvals.h"
+
+// Max-heap of items in [ 0, capacity ), each queued at most once with a float priority. Items know their place in the
+// heap, so any of them can be taken out or given a new priority in O(log n), and every priority can be replaced at
+// once in O(n). Not thread safe.
+
+typedef struct PriorityQueue PriorityQueue;
+
+PriorityQueue *create_priority_queue( size_t capacity );
+void delete_priority_queue( PriorityQueue *queue );
+
+size_t get_priority_queue_length( const PriorityQueue *queue );
+boolval is_priority_queue_item_queued( const PriorityQueue *queue, int item );
+
+// the item at a position in heap order, position 0 has the highest priority
+int get_priority_queue_item( const PriorityQueue *queue, size_t position );
+
+// queues the item, or moves it to its new priority if already queued
+void push_priority_queue( PriorityQueue *queue, int item, float priority );
+
+// -1 when empty
+int pop_priority_queue( PriorityQueue *queue );
+
+// false if the item was not queued
+boolval remove_priority_queue( PriorityQueue *queue, int item );
+
+// priority( item, data ) for every queued item, then a single rebuild of the heap
+void reprioritize_priority_queue( PriorityQueue *queue, float ( *priority )( int item, void *data ), void *data );
+
+#endif
@@ -1,7 +1,9 @@
 #include "quadtree.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -19,7 +21,17 @@
 
 #include "debug.h"
 
-const int QUAD_COUNT = 1 * pow( 2, TESSELLATIONS*2 );
+// chunks come in one size class per tessellation, each with its own VBO pools
+static size_t get_chunk_vertex_count( size_t tessellations )
+{
+	return ( pow( 2, tessellations ) + 1 ) * ( pow( 2, tessellations ) + 1 + ( CHUNK_SKIRTS ? 4 : 0 ) );
+}
+
+// an adaptive mesh has at most the full grid's triangles
+static size_t get_chunk_index_count( size_t tessellations )
+{
+	return 6 * pow( 2, tessellations ) * ( pow( 2, tessellations ) + ( CHUNK_SKIRTS ? 4 : 0 ) );
+}
 
 /// externs
 
@@ -46,8 +58,14 @@ typedef struct Node {
 	boolval covered;
 	struct Node *parent;
 	struct Node *neighbors[ 4 ]; // N, E, S, W, +x -> eastwards, -z -> northwards,
-	float *vertices_cache, *normals_cache;
+	float *vertices_cache; // heights of the chunk's vertex grid
+	short *normals_cache; // and its encoded normals
 	size_t stitchings[ 4 ];
+	NoiseFieldGrid *fields; // the chunk's value noise fields, upsampled by its children
+	size_t tessellations; // the chunk's, or the one requested for it
+	float roughness; // the chunk's change of slope across its vertices, for its children's tessellations
+	float min_height, max_height; // the chunk's grid heights, bounding its children's
+	GenerationRequestHandle request; // while awaiting
 } Node;
 
 /// quadtree parameters
@@ -57,6 +75,12 @@ float g_quadtree_root_size = 10000;
 float g_quadtree_min_distance = 20000;
 size_t g_quadtree_max_level = 7;
 
+// chunk meshes are vertex grids, every chunk of a tessellation is drawn with the same index buffer
+static GLuint g_quadtree_index_buffers[ MAX_TESSELLATIONS + 1 ] = { 0 };
+static size_t g_quadtree_index_counts[ MAX_TESSELLATIONS + 1 ] = { 0 };
+
+static char g_quadtree_pool_names[ QUADTREE_POOLS ][ MAX_TESSELLATIONS + 1 ][ 32 ];
+
 
 // quadtree mutators prototypes
 
@@ -79,7 +103,7 @@ static int get_neighbor_opposite_direction( int dir );
 static void update_node_neighbors( Node *node );
 static boolval is_node_visible( Node *node );
 static void evaluate_node_visible_neighbors( int x_coord, int z_coord, size_t level, Node **nodes_dest, size_t *levels_dest );
-static void stitch_node_side( Node *node, int x_coord, int z_coord, size_t level, size_t side, size_t delta_level );
+static void stitch_node_side( Node *node, int x_coord, int z_coord, size_t level, size_t side, size_t delta_level, size_t neighbor_tessellations );
 
 /// quadtree utilities
 
@@ -218,13 +242,23 @@ static Node *generate_node( Node *parent )
 	node->normals_cache = NULL;
 	size_t zero_stitchings[ 4 ] = { 0 };
 	memcpy( node->stitchings, zero_stitchings, sizeof( size_t ) * 4 );
+	node->fields = NULL;
+	node->tessellations = TESSELLATIONS;
+	node->roughness = 0;
+	node->min_height = 0;
+	node->max_height = 0;
+	node->request.index = -1;
 
 	return node;	
 }
 
-// frees up a node's vertices, or normals cache and sets them to NULL if it has either
+// frees up a node's vertices, normals or fields cache and sets them to NULL if it has any
 static void empty_node_cache( Node *node )
 {
+	if ( node->fields != NULL ){
+		delete_noise_field_grid( node->fields );
+		node->fields = NULL;
+	}
 	if ( node->vertices_cache != NULL ){
 		free( node->vertices_cache );
 		node->vertices_cache = NULL;
@@ -235,10 +269,25 @@ static void empty_node_cache( Node *node )
 	}
 }
 
+// gives a chunk's buffers back to the pools of its tessellation and deletes it, the shared index buffer stays
+static void delete_chunk_object( PerspectiveObject *obj, size_t tessellations )
+{
+	obj->meshInitialized = false;
+	obj->normalsInitialized = false;
+	obj->vertices = 0;
+	yield_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_HEIGHTS, tessellations ), obj->meshVBO );
+	yield_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_NORMALS, tessellations ), obj->normalsVBO );
+	if ( ADAPTIVE_MESH ) yield_vbo_pool_buffer( get_quadtree_vbo_pool( QUADTREE_POOL_INDICES, tessellations ), obj->IBO );
+
+	deletePerspectiveObject( obj );
+}
+
 // turns a node into an empty node, by deleting its perspective obj. if it has one
 static void empty_node( Node *node )
 {
 	if ( node->state == NODE_STATE_AWAITING ) {
+		cancel_generation_request( node->request );
+		node->request.index = -1;
 		node->state = NODE_STATE_EMPTY;
 		return;
 	}else if ( node->state == NODE_STATE_EMPTY ) return;
@@ -256,13 +305,7 @@ static void empty_node( Node *node )
 		yield_mem_pool_buffer( "ChunkManifold", old_data );
 	}
 
-	obj->meshInitialized = false;
-	obj->normalsInitialized = false;
-	obj->vertices = 0;
-	yield_vbo_pool_buffer( "Quadtree", obj->meshVBO );
-	yield_vbo_pool_buffer( "Quadtree", obj->normalsVBO );
-
-	deletePerspectiveObject( obj );
+	delete_chunk_object( obj, node->tessellations );
 	empty_node_cache( node );
 	node->state = NODE_STATE_EMPTY;
 
@@ -361,12 +404,16 @@ static void remerge_node( Node *node )
 }
 
 // transforms a node into a chunk node
-void push_quadtree_chunk( int x_coord, int z_coord, size_t level, PerspectiveObject *obj, float *vertices, float *normals )
+void push_quadtree_chunk( int x_coord, int z_coord, size_t level, PerspectiveObject *obj, float *vertices, short *normals, NoiseFieldGrid *fields, float roughness, float min_height, float max_height )
 {
 	boolval terrain_present = false;
 	Node *node = search_node( x_coord, z_coord, level, &terrain_present );
 	if ( !node || node->state != NODE_STATE_AWAITING ){
-		deletePerspectiveObject( obj );
+		// the node may be gone, the grid's side gives the pools the buffers came from
+		delete_chunk_object( obj, ( size_t ) log2( obj->gridSideVertices - 1 ) );
+		delete_noise_field_grid( fields );
+		free( vertices );
+		free( normals );
 		return;
 	}
 
@@ -381,8 +428,22 @@ void push_quadtree_chunk( int x_coord, int z_coord, size_t level, PerspectiveObj
 	}
 	
 	node->state = NODE_STATE_CHUNK;
-	node->vertices_cache = vertices;
-	node->normals_cache = normals;
+	node->request.index = -1;
+	node->fields = fields;
+	node->roughness = roughness;
+	node->min_height = min_height;
+	node->max_height = max_height;
+
+	// skirts and geomorphing hide the cracks without touching the uploaded mesh, only the height grid is kept, for the
+	// children to morph into
+	if ( CHUNK_SKIRTS || CDLOD_MORPH ){
+		const size_t side = pow( 2, node->tessellations ) + 1;
+		node->vertices_cache = realloc( vertices, sizeof( float ) * side * side );
+		free( normals );
+	}else{
+		node->vertices_cache = vertices;
+		node->normals_cache = normals;
+	}
 
 	establish_node_coverage_chain( node );
 
@@ -392,12 +453,14 @@ void push_quadtree_chunk( int x_coord, int z_coord, size_t level, PerspectiveObj
 
 	// debug
 
+	if ( CHUNK_SKIRTS || CDLOD_MORPH ) return;
+
 //	if ( obj->visible ){
 		Node *visible_neighbors[ 4 ];
 		size_t vn_levels[ 4 ];
 		evaluate_node_visible_neighbors( x_coord, z_coord, level, visible_neighbors, vn_levels );
 		if ( visible_neighbors[ 0 ] && vn_levels[ 0 ] < level ){
-			stitch_node_side( node, x_coord, z_coord, level, 0, level - vn_levels[ 0 ] );
+			stitch_node_side( node, x_coord, z_coord, level, 0, level - vn_levels[ 0 ], visible_neighbors[ 0 ]->tessellations );
 		}
 //	}
 }
@@ -485,13 +548,62 @@ static PerspectiveObject *get_node_object( Node *node )
 
 }
 
-// sets a node in an awaiting state, and requests terrain generation for it
+// chunks take their resolution from their level and their parent's roughness, TESSELLATIONS without a parent chunk
+static size_t get_node_tessellations( Node *node, size_t level )
+{
+	if ( node->parent == NULL || node->parent->state != NODE_STATE_CHUNK ) return TESSELLATIONS;
+	return getTessellationsForRoughness( node->parent->roughness, level );
+}
+
+// the parent chunk's heights, unbounded without a parent chunk; the node's own detail can go a parent vertex spacing past them
+static void get_node_height_bounds( Node *node, size_t level, float *min_height, float *max_height )
+{
+	*min_height = -FLT_MAX;
+	*max_height = FLT_MAX;
+	if ( node->parent == NULL || node->parent->state != NODE_STATE_CHUNK ) return;
+
+	const float margin = g_quadtree_root_size / pow( 2, level - 1 ) / pow( 2, node->parent->tessellations );
+	*min_height = node->parent->min_height - margin;
+	*max_height = node->parent->max_height + margin;
+}
+
+// the parent chunk's grid heights over the node, at morph_tessellations, NULL without them
+static float *get_node_morph_heights( Node *node, int x_coord, int z_coord, size_t morph_tessellations )
+{
+	if ( node->parent == NULL || node->parent->state != NODE_STATE_CHUNK || node->parent->vertices_cache == NULL ) return NULL;
+
+	const size_t parent_side = pow( 2, node->parent->tessellations ) + 1, half = parent_side / 2;
+	const size_t side = pow( 2, morph_tessellations ) + 1, stride = half / ( side - 1 );
+	const size_t start_x = x_coord % 2 * half, start_z = z_coord % 2 * half;
+	float *heights = malloc( sizeof( float ) * side * side );
+	for ( size_t z = 0; z < side; ++z )
+		for ( size_t x = 0; x < side; ++x )
+			heights[ z * side + x ] = node->parent->vertices_cache[ ( start_z + z * stride ) * parent_side + start_x + x * stride ];
+	return heights;
+}
+
+// sets a node in an awaiting state, and requests terrain generation for it, from its parent's fields when it has a chunk
 static void request_node_terrain_generation( Node* node, int x_coord, int z_coord, size_t level )
 {
 	if ( node->state != NODE_STATE_EMPTY ) return;
-	boolval result = request_generation( x_coord, z_coord, level, TESSELLATIONS );
-	if ( !result ){
+	boolval parent_chunk = node->parent != NULL && node->parent->state == NODE_STATE_CHUNK;
+	NoiseFieldGrid *parent_fields = parent_chunk ? node->parent->fields : NULL;
+	size_t tessellations = get_node_tessellations( node, level );
+
+	// the parent's quads over the chunk, a quarter of them per side; the morph can't go finer than half the chunk's own
+	size_t morph_tessellations = tessellations - 1;
+	if ( parent_chunk && node->parent->tessellations < tessellations ) morph_tessellations = node->parent->tessellations - 1;
+
+	float min_height, max_height;
+	get_node_height_bounds( node, level, &min_height, &max_height );
+
+	float *morph_heights = CDLOD_MORPH ? get_node_morph_heights( node, x_coord, z_coord, morph_tessellations ) : NULL;
+	GenerationRequestHandle request = request_generation( x_coord, z_coord, level, tessellations, morph_tessellations, parent_fields, morph_heights, min_height, max_height );
+	free( morph_heights );
+	if ( request.index != -1 ){
 		node->state = NODE_STATE_AWAITING;	
+		node->tessellations = tessellations;
+		node->request = request;
 	}
 }
 
@@ -595,131 +707,65 @@ static void evaluate_node_visible_neighbors( int x_coord, int z_coord, size_t le
 	if ( levels_dest != NULL ) memcpy( levels_dest, rlevels, sizeof( size_t ) * 4 );
 }
 
-// stitches a node's given side
-static void stitch_node_side( Node *node, int x_coord, int z_coord, size_t level, size_t side, size_t delta_level )
+// stitches a node's given side, by interpolating its edge vertices' heights along the larger neighbor's edges
+static void stitch_node_side( Node *node, int x_coord, int z_coord, size_t level, size_t side, size_t delta_level, size_t neighbor_tessellations )
 {
 	if ( node->state != NODE_STATE_CHUNK ) return;
 	side %= 4;
 	PerspectiveObject *obj = get_node_object( node );
 
-	size_t quads_per_side = 1 * pow( 2, level ), 
-		start_q, q_next, v1, v2, v3,
-		terrain_quads_per_side_quad = pow( 2, delta_level );
-	boolval pairing = false;
+	// how many of the node's quads one of the neighbor's spans
+	int quads_ratio_exponent = ( int ) delta_level + ( int ) node->tessellations - ( int ) neighbor_tessellations;
+	if ( quads_ratio_exponent <= 0 ) return;
 
-	// v values are vertex indices going on the side from left to right, top to bottom, and mapped on the quad's vertices
+	size_t quads_per_side = 1 * pow( 2, node->tessellations ),
+		vertices_per_side = quads_per_side + 1,
+		start_v, v_next,
+		terrain_quads_per_side_quad = min( pow( 2, quads_ratio_exponent ), quads_per_side );
+
+	// the side's vertices in the chunk's vertex grid, going from left to right, top to bottom
 
 	switch (side)
 	{
 		case 0:
-			//start_q = quads_per_side * ( quads_per_side - 1 );
-			start_q = 0;
-			q_next = 1;
-			// { v1 | v2 }, v3 
-			pairing = false;
-			v1 = 0;
-			v2 = 3;
-			v3 = 5;
+			start_v = 0;
+			v_next = 1;
 			break;
 		case 1:
-			start_q = quads_per_side - 1;
-			q_next = quads_per_side;
-			// v1, { v2 | v3 }
-			pairing = true;
-			v1 = 5;
-			v2 = 3;
-			v3 = 2;
+			start_v = quads_per_side;
+			v_next = vertices_per_side;
 			break;
 		case 2:
-			start_q = quads_per_side * ( quads_per_side - 1 );
-			q_next = 1;
-			// { v1 | v2 }, v3
-			pairing = false;
-			v1 = 1;
-			v2 = 4;
-			v3 = 5;
+			start_v = vertices_per_side * quads_per_side;
+			v_next = 1;
 			break;
 		default:
-			start_q = 0;
-			q_next = quads_per_side;
-			// { v1 | v2 }, v3
-			pairing = false;
-			v1 = 1;
-			v2 = 4;
-			v3 = 0;
+			start_v = 0;
+			v_next = vertices_per_side;
 			break;
 	}
 
-	// quad index, mapped from NW to SE
-
+	glBindBuffer( GL_ARRAY_BUFFER, obj->meshVBO );
 
-	for ( size_t q = 0; q < quads_per_side; ++q )
+	for ( size_t v = 0; v < vertices_per_side; ++v )
 	{
-		size_t local_q_side_index = q % terrain_quads_per_side_quad,
-			q_slice_side_first = q - local_q_side_index, 
-			q_slice_side_last = q_slice_side_first + terrain_quads_per_side_quad - 1;
-
-		size_t q_slice_first_index = start_q + q_slice_side_first * q_next,
-			q_slice_last_index = start_q + q_slice_side_last * q_next,
-			q_index = start_q + q * q_next;
-
-		size_t vertex_slice_first_index = q_slice_first_index * 6 + v1,
-			vertex_slice_last_index = q_slice_last_index * 6 + v3;
+		size_t local_v_side_index = v % terrain_quads_per_side_quad;
+		if ( local_v_side_index == 0 ) continue; // the ends of each slice are shared with the neighbor
 
-		Vec3fl vertex_slice_first = *( ( Vec3fl* ) node->vertices_cache + vertex_slice_first_index ),
-			vertex_slice_last = *( ( Vec3fl* ) node->vertices_cache + vertex_slice_last_index );
+		size_t v_slice_side_first = v - local_v_side_index,
+			v_slice_side_last = v_slice_side_first + terrain_quads_per_side_quad;
 
-		float vertex_slice_first_distance_quotient = ( 0.0f + ( float ) local_q_side_index ) / ( float ) terrain_quads_per_side_quad;
-		float vertex_slice_second_distance_quotient = ( 1.0f + ( float ) local_q_side_index ) / ( float ) terrain_quads_per_side_quad;
+		float vertex_slice_first_height = node->vertices_cache[ start_v + v_slice_side_first * v_next ],
+			vertex_slice_last_height = node->vertices_cache[ start_v + v_slice_side_last * v_next ];
 
-		float first_vert_height = vertex_slice_first_distance_quotient * vertex_slice_last.y +
-					( 1.0f - vertex_slice_first_distance_quotient ) * vertex_slice_first.y;
+		float vertex_distance_quotient = ( float ) local_v_side_index / ( float ) terrain_quads_per_side_quad;
 
-		float second_vert_height = vertex_slice_second_distance_quotient * vertex_slice_last.y +
-					( 1.0f - vertex_slice_second_distance_quotient ) * vertex_slice_first.y;
-
-		size_t q_slice_first_vertex_index = q_slice_first_index * 6,
-			q_slice_last_vertex_index = q_slice_last_index * 6;
-
-		if ( pairing ){
-			size_t first_vert_index_1 = q_slice_first_vertex_index + v1,
-				first_vert_index_2 = q_slice_first_vertex_index + v2,
-				last_vert_index = q_slice_last_vertex_index + v3;
-
-			size_t first_vert_offset_1 = first_vert_index_1 * sizeof( float ) * 3,
-				first_vert_offset_2 = first_vert_index_2 * sizeof( float ) * 3,
-				last_vert_offset = last_vert_index * sizeof( float ) * 3;
-
-			size_t first_float_offset_1 = first_vert_offset_1 + sizeof( float ),
-				first_float_offset_2 = first_vert_offset_2 + sizeof( float ),
-				last_float_offset = last_vert_offset + sizeof( float );
-
-			glBindBuffer( GL_ARRAY_BUFFER, obj->meshVBO );
-			glBufferSubData( GL_ARRAY_BUFFER, first_float_offset_1, sizeof( float ), &first_vert_height );
-			glBufferSubData( GL_ARRAY_BUFFER, first_float_offset_2, sizeof( float ), &first_vert_height );
-			glBufferSubData( GL_ARRAY_BUFFER, last_float_offset, sizeof( float ), &second_vert_height );
-		}else{
-			size_t first_vert_index = q_slice_first_vertex_index + v1,
-				last_vert_index_1 = q_slice_last_vertex_index + v2,
-				last_vert_index_2 = q_slice_last_vertex_index + v3;
-
-			size_t first_vert_offset = first_vert_index * sizeof( float ) * 3,
-				last_vert_offset_1 = last_vert_index_1 * sizeof( float ) * 3,
-				last_vert_offset_2 = last_vert_index_2 * sizeof( float ) * 3;
-
-			size_t first_float_offset = first_vert_offset + sizeof( float ),
-				last_float_offset_1 = last_vert_offset_1 + sizeof( float ),
-				last_float_offset_2 = last_vert_offset_2 + sizeof( float );
-
-			glBindBuffer( GL_ARRAY_BUFFER, obj->meshVBO );
-			glBufferSubData( GL_ARRAY_BUFFER, first_float_offset, sizeof( float ), &first_vert_height );
-			glBufferSubData( GL_ARRAY_BUFFER, last_float_offset_1, sizeof( float ), &second_vert_height );
-			glBufferSubData( GL_ARRAY_BUFFER, last_float_offset_2, sizeof( float ), &second_vert_height );
-		}
+		float vert_height = vertex_distance_quotient * vertex_slice_last_height +
+					( 1.0f - vertex_distance_quotient ) * vertex_slice_first_height;
 
+		size_t vert_offset = ( start_v + v * v_next ) * sizeof( float );
+		glBufferSubData( GL_ARRAY_BUFFER, vert_offset, sizeof( float ), &vert_height );
 	}
-
-	//TODO		
 }
 
 /// terrain control
@@ -776,7 +822,12 @@ void initialize_quadtree()
 		NULL,
 		{ NULL },
 		NULL, NULL,
-		{ 0 }
+		{ 0 },
+		NULL,
+		TESSELLATIONS,
+		0,
+		0, 0,
+		{ -1, 0 }
 	};
 	g_quadtree_root = empty_node;
 	
@@ -784,21 +835,63 @@ void initialize_quadtree()
 	gen_mem_pool( "EmptyManifold", sizeof( Node* ) * 4 );
 	gen_mem_pool( "ChunkManifold", sizeof( Node* ) * 4 + sizeof( PerspectiveObject* ) );
 
-	gen_vbo_pool( "Quadtree", sizeof( float ) * 3 * QUAD_COUNT * 6 );
+	for ( size_t tessellations = MIN_TESSELLATIONS; tessellations <= MAX_TESSELLATIONS; ++tessellations ){
+		snprintf( g_quadtree_pool_names[ QUADTREE_POOL_HEIGHTS ][ tessellations ], 32, "QuadtreeHeights%zu", tessellations );
+		snprintf( g_quadtree_pool_names[ QUADTREE_POOL_NORMALS ][ tessellations ], 32, "QuadtreeNormals%zu", tessellations );
+		snprintf( g_quadtree_pool_names[ QUADTREE_POOL_INDICES ][ tessellations ], 32, "QuadtreeIndices%zu", tessellations );
+
+		size_t vertex_count = get_chunk_vertex_count( tessellations );
+		gen_vbo_pool( g_quadtree_pool_names[ QUADTREE_POOL_HEIGHTS ][ tessellations ], sizeof( float ) * vertex_count * ( CDLOD_MORPH ? 2 : 1 ) );
+		gen_vbo_pool( g_quadtree_pool_names[ QUADTREE_POOL_NORMALS ][ tessellations ], sizeof( short ) * 2 * vertex_count );
+		if ( ADAPTIVE_MESH ) gen_vbo_pool( g_quadtree_pool_names[ QUADTREE_POOL_INDICES ][ tessellations ], sizeof( unsigned int ) * get_chunk_index_count( tessellations ) );
+	}
 }
 
 void terminate_quadtree()
 {
-	remove_vbo_pool( "Quadtree" );
+	for ( size_t tessellations = MIN_TESSELLATIONS; tessellations <= MAX_TESSELLATIONS; ++tessellations ){
+		if ( ADAPTIVE_MESH ) remove_vbo_pool( g_quadtree_pool_names[ QUADTREE_POOL_INDICES ][ tessellations ] );
+		remove_vbo_pool( g_quadtree_pool_names[ QUADTREE_POOL_NORMALS ][ tessellations ] );
+		remove_vbo_pool( g_quadtree_pool_names[ QUADTREE_POOL_HEIGHTS ][ tessellations ] );
+	}
+
+	for ( size_t i = 0; i <= MAX_TESSELLATIONS; ++i ){
+		if ( g_quadtree_index_buffers[ i ] == 0 ) continue;
+		glDeleteBuffers( 1, &g_quadtree_index_buffers[ i ] );
+		g_quadtree_index_buffers[ i ] = 0;
+	}
 
 	remove_mem_pool( "ChunkManifold" );
 	remove_mem_pool( "EmptyManifold" );
 	remove_mem_pool( "Node" );
 }
 
+char *get_quadtree_vbo_pool( enum QuadtreePool pool, size_t tessellations )
+{
+	return g_quadtree_pool_names[ pool ][ tessellations ];
+}
+
+GLuint get_quadtree_index_buffer( size_t tessellations, size_t *indices_count )
+{
+	if ( tessellations > MAX_TESSELLATIONS ) return 0;
+
+	if ( g_quadtree_index_buffers[ tessellations ] == 0 ){
+		unsigned int *indices = generateTessellatedQuadIndices( tessellations, CHUNK_SKIRTS, &g_quadtree_index_counts[ tessellations ] );
+		if ( VERTEX_CACHE_OPTIMIZATION ) optimizeVertexCacheOrder( indices, g_quadtree_index_counts[ tessellations ] );
+		g_quadtree_index_buffers[ tessellations ] = createAndFillVBO( indices, g_quadtree_index_counts[ tessellations ] * sizeof( unsigned int ), GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW );
+		free( indices );
+	}
+
+	*indices_count = g_quadtree_index_counts[ tessellations ];
+	return g_quadtree_index_buffers[ tessellations ];
+}
+
 void poll_quadtree()
 {
 	poll_node( &g_quadtree_root, 0, 0, 0, false );
+
+	// wakes the workers once the whole pass is queued, so a node's four children can still be taken as one batch
+	flush_generation_requests();
 }
 
 
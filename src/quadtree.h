@@ -3,12 +3,21 @@
 
 #include "utils.h"
 #include "boolvals.h"
+#include "noisegraph.h"
 
 struct PerspectiveObject;
 typedef struct PerspectiveObject PerspectiveObject;
 
+// the VBO pools chunk buffers come from, one size class per tessellation from MIN_TESSELLATIONS to MAX_TESSELLATIONS
+enum QuadtreePool {
+	QUADTREE_POOL_HEIGHTS,
+	QUADTREE_POOL_NORMALS,
+	QUADTREE_POOL_INDICES, // adaptive meshes only
+	QUADTREE_POOLS
+};
+
 // quadtree mutators
-void push_quadtree_chunk( int x_coord, int z_coord, size_t level, PerspectiveObject *obj, float *vertices, float *normals );
+void push_quadtree_chunk( int x_coord, int z_coord, size_t level, PerspectiveObject *obj, float *vertices, short *normals, NoiseFieldGrid *fields, float roughness, float min_height, float max_height );
 
 // terrain control
 
@@ -16,4 +25,9 @@ void initialize_quadtree();
 void terminate_quadtree();
 void poll_quadtree();
 
+// the immutable index buffer drawing chunks of that tessellation, generated on first use (needs the GL context)
+GLuint get_quadtree_index_buffer( size_t tessellations, size_t *indices_count );
+
+char *get_quadtree_vbo_pool( enum QuadtreePool pool, size_t tessellations );
+
 #endif
@@ -308,7 +308,7 @@ void thread_sleep( unsigned int ms )
 #include <unistd.h>
 void thread_sleep( unsigned int ms )
 {
-	sleep( ( float ) ms / 1000.0 );
+	usleep( ms * 1000 );
 }
 #endif
 